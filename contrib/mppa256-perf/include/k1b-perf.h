@@ -25,8 +25,11 @@
 #ifndef K1B_PERF_H_
 #define K1B_PERF_H_
 
+#ifdef __k1__
+	#include <HAL/hal/hal.h>
 	#include <HAL/hal/core/diagnostic.h>
 	#include <HAL/hal/cluster/dsu.h>
+#endif
 
 	#include <errno.h>
 	#include <stdint.h>
@@ -41,6 +44,21 @@
 	 */
 	#define K1B_PERF_MONITORS_NUM 2
 
+	/**
+	 * @brief Maximum number of cores.
+	 */
+	#define K1B_PERF_CORES_NUM 16
+
+	/**
+	 * @brief Maximum number of profiling regions.
+	 */
+	#define K1B_PERF_REGIONS_NUM 16
+
+	/**
+	 * @brief Maximum nesting depth of profiling regions.
+	 */
+	#define K1B_PERF_REGIONS_DEPTH 8
+
 	/**
 	 * @name Performance Monitors 
 	 */
@@ -53,6 +71,7 @@
 	 * @name Performance Events
 	 */
 	/**@{*/
+#ifdef __k1__
 	#define K1B_PERF_CYCLES         _K1_CYCLE_COUNT        /**< Timer Cycles                    */
 	#define K1B_PERF_ICACHE_HITS    _K1_IHITS              /**< Instruction Cache Hits          */
 	#define K1B_PERF_ICACHE_MISSES  _K1_IMISS              /**< Instruction Cache Misses        */
@@ -67,6 +86,28 @@
 	#define K1B_PERF_ITLB_STALLS    _K1_ITLB_STALLS        /**< Instruction TLB Stalls          */
 	#define K1B_PERF_DTLB_STALLS    _K1_DTLB_STALLS        /**< Data TLB Stalls                 */
 	#define K1B_PERF_STREAM_STALLS  _K1_STREAM_LOAD_STALLS /**< Stream Buffer Stalls            */
+#else
+	#define K1B_PERF_CYCLES          0 /**< Timer Cycles                    */
+	#define K1B_PERF_ICACHE_HITS     1 /**< Instruction Cache Hits          */
+	#define K1B_PERF_ICACHE_MISSES   2 /**< Instruction Cache Misses        */
+	#define K1B_PERF_ICACHE_STALLS   3 /**< Instruction Cache Misses Stalls */
+	#define K1B_PERF_DCACHE_HITS     4 /**< Data Cache Hits                 */
+	#define K1B_PERF_DCACHE_MISSES   5 /**< Data Cache Misses               */
+	#define K1B_PERF_DCACHE_STALLS   6 /**< Data Cache Misses Stalls        */
+	#define K1B_PERF_BUNDLES         7 /**< Bundles Executed                */
+	#define K1B_PERF_BRANCH_TAKEN    8 /**< Branches Taken                  */
+	#define K1B_PERF_BRANCH_STALLS   9 /**< Branches Stalled                */
+	#define K1B_PERF_REG_STALLS     10 /**< Register Dependence Stalls      */
+	#define K1B_PERF_ITLB_STALLS    11 /**< Instruction TLB Stalls          */
+	#define K1B_PERF_DTLB_STALLS    12 /**< Data TLB Stalls                 */
+	#define K1B_PERF_STREAM_STALLS  13 /**< Stream Buffer Stalls            */
+
+	/**
+	 * @brief Frequency (in MHz) at which time is converted into
+	 * cycles on Linux hosts.
+	 */
+	#define K1B_PERF_HOST_FREQ 400
+#endif
 	/**@}*/
 
 	/**
@@ -113,40 +154,224 @@
 	 */
 	extern int k1b_perf_stop(int perf);
 
+	/**
+	 * @brief Value returned upon a failed read.
+	 */
+	#define K1B_PERF_INVALID ((uint64_t) -1)
+
+#ifdef __k1__
+
 	/**
 	 * @brief Reads a PM register.
 	 *
 	 * @param perf Target performance monitor.
 	 *
 	 * @returns Upon successful completion, the value of the target
-	 * performance monitor. Upon failure, -1 converted to uint64_t is
-	 * returned instead.
+	 * performance monitor. Upon failure, K1B_PERF_INVALID is returned
+	 * instead.
+	 *
+	 * @note The upper half is read twice, so that a carry from the
+	 * lower half of a running monitor is not lost.
 	 */
 	static __inline__ uint64_t k1b_perf_read(int perf)
 	{
 		uint32_t hi;
+		uint32_t hi2;
 		uint32_t lo;
 
 		switch (perf)
 		{
 			case K1B_PERF_PM_0_1:
-				__asm__ __volatile__ ("get %0, $pm0;;": "=r" (lo));
-				__asm__ __volatile__ ("get %0, $pm1;;": "=r" (hi));
+				do
+				{
+					__asm__ __volatile__ ("get %0, $pm1;;": "=r" (hi));
+					__asm__ __volatile__ ("get %0, $pm0;;": "=r" (lo));
+					__asm__ __volatile__ ("get %0, $pm1;;": "=r" (hi2));
+				} while (hi != hi2);
 				break;
 
 			case K1B_PERF_PM_2_3:
-				__asm__ __volatile__ ("get %0, $pm2;;": "=r" (lo));
-				__asm__ __volatile__ ("get %0, $pm3;;": "=r" (hi));
+				do
+				{
+					__asm__ __volatile__ ("get %0, $pm3;;": "=r" (hi));
+					__asm__ __volatile__ ("get %0, $pm2;;": "=r" (lo));
+					__asm__ __volatile__ ("get %0, $pm3;;": "=r" (hi2));
+				} while (hi != hi2);
 				break;
 
 			default:
-				return ((uint64_t) - 1);
+				return (K1B_PERF_INVALID);
 				break;
 		}
 
 		return ((((uint64_t) hi) << 32ull) | (lo));
 	}
 
+	/**
+	 * @brief Returns the ID of the underlying core.
+	 */
+	static __inline__ int k1b_perf_core_id(void)
+	{
+		return (__k1_get_cpu_id());
+	}
+
+	/**
+	 * @brief Reads the timestamp of the cluster, which is shared by
+	 * all cores.
+	 */
+	static __inline__ uint64_t k1b_perf_timestamp(void)
+	{
+		return (__k1_read_dsu_timestamp());
+	}
+
+#else
+
+	/**
+	 * @brief Reads a PM register.
+	 *
+	 * @param perf Target performance monitor.
+	 *
+	 * @returns Upon successful completion, the value of the target
+	 * performance monitor. Upon failure, K1B_PERF_INVALID is returned
+	 * instead.
+	 */
+	extern uint64_t k1b_perf_read(int perf);
+
+	/**
+	 * @brief Sets the ID of the underlying core of the calling thread.
+	 *
+	 * @param id Slot of the thread in per-core data.
+	 */
+	extern void k1b_perf_core_set(int id);
+
+	/**
+	 * @brief Returns the ID of the underlying core.
+	 *
+	 * @note On Linux hosts, CPUs may be shared and threads may
+	 * migrate, thus this is a slot of the calling thread in per-core
+	 * data, set with k1b_perf_core_set(). Threads that set none share
+	 * slot zero.
+	 */
+	extern int k1b_perf_core_id(void);
+
+	/**
+	 * @brief Reads the timestamp of the cluster, which is shared by
+	 * all cores.
+	 *
+	 * @note On Linux hosts, this is the monotonic clock, in cycles of
+	 * K1B_PERF_HOST_FREQ.
+	 */
+	extern uint64_t k1b_perf_timestamp(void);
+
+#endif
+
+	/**
+	 * @brief Statistics of a profiling region.
+	 */
+	struct k1b_perf_region
+	{
+		uint64_t inclusive; /**< Events Counted Inside the Region           */
+		uint64_t exclusive; /**< Events Counted Outside of Nested Regions   */
+		uint64_t count;     /**< Number of Times the Region was Entered     */
+	};
+
+	/**
+	 * @brief Sets up profiling regions in the underlying core.
+	 *
+	 * The performance monitor K1B_PERF_PM_2_3 is left running, and
+	 * regions of the underlying core are cleared.
+	 *
+	 * @param event Target event to watch.
+	 *
+	 * @returns Upon successful completion, zero is returned. Upon
+	 * failure, a negative error code is returned instead.
+	 */
+	extern int k1b_perf_region_setup(int event);
+
+	/**
+	 * @brief Clears profiling regions of a core.
+	 *
+	 * @param core Target core.
+	 *
+	 * @returns Upon successful completion, zero is returned. Upon
+	 * failure, a negative error code is returned instead.
+	 */
+	extern int k1b_perf_region_clear(int core);
+
+	/**
+	 * @brief Names a profiling region.
+	 *
+	 * @param region Target region.
+	 * @param name   Name of the region.
+	 *
+	 * @returns Upon successful completion, zero is returned. Upon
+	 * failure, a negative error code is returned instead.
+	 */
+	extern int k1b_perf_region_register(int region, const char *name);
+
+	/**
+	 * @brief Gets the name of a profiling region.
+	 *
+	 * @param region Target region.
+	 *
+	 * @returns The name of the target region, or NULL if it has no
+	 * name.
+	 */
+	extern const char *k1b_perf_region_name(int region);
+
+	/**
+	 * @brief Enters a profiling region in the underlying core.
+	 *
+	 * @param region Target region.
+	 *
+	 * @returns Upon successful completion, zero is returned. Upon
+	 * failure, a negative error code is returned instead.
+	 */
+	extern int k1b_perf_region_begin(int region);
+
+	/**
+	 * @brief Leaves a profiling region in the underlying core.
+	 *
+	 * @param region Target region. It should be the last region
+	 * entered.
+	 *
+	 * @returns Upon successful completion, zero is returned. Upon
+	 * failure, a negative error code is returned instead.
+	 */
+	extern int k1b_perf_region_end(int region);
+
+	/**
+	 * @brief Reads the statistics of a profiling region.
+	 *
+	 * @param core   Target core.
+	 * @param region Target region.
+	 * @param stats  Store location for statistics.
+	 *
+	 * @returns Upon successful completion, zero is returned. Upon
+	 * failure, a negative error code is returned instead.
+	 */
+	extern int k1b_perf_region_read(int core, int region, struct k1b_perf_region *stats);
+
+	/**
+	 * @name Profiling Regions
+	 *
+	 * Profiling regions are compiled only if K1B_PERF_REGIONS is
+	 * defined, so they may be left in the code at no cost.
+	 */
+	/**@{*/
+	#ifdef K1B_PERF_REGIONS
+		#define K1B_PERF_REGION_SETUP(event)       k1b_perf_region_setup(event)
+		#define K1B_PERF_REGION_NAME(region, name) k1b_perf_region_register(region, name)
+		#define K1B_PERF_REGION_BEGIN(region)      k1b_perf_region_begin(region)
+		#define K1B_PERF_REGION_END(region)        k1b_perf_region_end(region)
+	#else
+		#define K1B_PERF_REGION_SETUP(event)       ((void) 0)
+		#define K1B_PERF_REGION_NAME(region, name) ((void) 0)
+		#define K1B_PERF_REGION_BEGIN(region)      ((void) 0)
+		#define K1B_PERF_REGION_END(region)        ((void) 0)
+	#endif
+	/**@}*/
+
 #endif /* K1B_PERF_H_ */
 
 
@@ -0,0 +1,305 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2019 Pedro Henrique Penna <pedrohenriquepenna@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ * Performance monitors for Linux hosts. Cycles are measured with the
+ * monotonic clock, at K1B_PERF_HOST_FREQ, and the remaining events are
+ * mapped onto the nearest hardware events of Linux perf. Events that
+ * have no counterpart, or that are not available to the calling
+ * process, read as zero.
+ */
+
+#define _GNU_SOURCE
+
+#include <k1b-perf.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Builds the configuration of a hardware cache event.
+ *
+ * @param cache  Target cache.
+ * @param result Access or miss.
+ */
+#define K1B_PERF_HOST_CACHE(cache, result)      \
+	((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | ((result) << 16))
+
+/**
+ * @brief Linux perf counterparts of performance events.
+ */
+static const struct
+{
+	uint32_t type;   /**< Event Type (PERF_TYPE_MAX if None) */
+	uint64_t config; /**< Event Configuration                */
+} events[K1B_PERF_EVENTS_NUM] = {
+	[K1B_PERF_CYCLES]        = { PERF_TYPE_MAX,      0                                                                         },
+	[K1B_PERF_ICACHE_HITS]   = { PERF_TYPE_HW_CACHE, K1B_PERF_HOST_CACHE(PERF_COUNT_HW_CACHE_L1I, PERF_COUNT_HW_CACHE_RESULT_ACCESS) },
+	[K1B_PERF_ICACHE_MISSES] = { PERF_TYPE_HW_CACHE, K1B_PERF_HOST_CACHE(PERF_COUNT_HW_CACHE_L1I, PERF_COUNT_HW_CACHE_RESULT_MISS)   },
+	[K1B_PERF_ICACHE_STALLS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND                                     },
+	[K1B_PERF_DCACHE_HITS]   = { PERF_TYPE_HW_CACHE, K1B_PERF_HOST_CACHE(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_ACCESS) },
+	[K1B_PERF_DCACHE_MISSES] = { PERF_TYPE_HW_CACHE, K1B_PERF_HOST_CACHE(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS)   },
+	[K1B_PERF_DCACHE_STALLS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND                                      },
+	[K1B_PERF_BUNDLES]       = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS                                                },
+	[K1B_PERF_BRANCH_TAKEN]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS                                         },
+	[K1B_PERF_BRANCH_STALLS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES                                               },
+	[K1B_PERF_REG_STALLS]    = { PERF_TYPE_MAX,      0                                                                         },
+	[K1B_PERF_ITLB_STALLS]   = { PERF_TYPE_HW_CACHE, K1B_PERF_HOST_CACHE(PERF_COUNT_HW_CACHE_ITLB, PERF_COUNT_HW_CACHE_RESULT_MISS)  },
+	[K1B_PERF_DTLB_STALLS]   = { PERF_TYPE_HW_CACHE, K1B_PERF_HOST_CACHE(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS)  },
+	[K1B_PERF_STREAM_STALLS] = { PERF_TYPE_MAX,      0                                                                         },
+};
+
+/**
+ * @brief Performance monitor of a thread.
+ */
+struct k1b_perf_monitor
+{
+	int event;      /**< Event Watched           */
+	bool running;   /**< Is it Running?          */
+	int fd;         /**< Linux perf Descriptor   */
+	uint64_t start; /**< Time when Started       */
+	uint64_t value; /**< Value when Stopped      */
+};
+
+/**
+ * @brief Performance monitors of the calling thread.
+ */
+static __thread struct k1b_perf_monitor monitors[K1B_PERF_MONITORS_NUM] = {
+	{ -1, false, -1, 0, 0 },
+	{ -1, false, -1, 0, 0 },
+};
+
+/**
+ * @brief Asserts a valid performance monitor.
+ *
+ * @param perf Monitor to assert.
+ *
+ * @returns True if the performance monitor is valid and false
+ * otherwise.
+ */
+static __inline__ bool k1b_perf_monitor_is_valid(int perf)
+{
+	return ((perf >= 0) && (perf < K1B_PERF_MONITORS_NUM));
+}
+
+/**
+ * @brief Asserts a valid performance event.
+ *
+ * @param event Event to assert.
+ *
+ * @returns True if the performance event is valid and false
+ * otherwise.
+ */
+static __inline__ bool k1b_perf_event_is_valid(int event)
+{
+	return ((event >= 0) && (event < K1B_PERF_EVENTS_NUM));
+}
+
+/**
+ * @brief Reads the monotonic clock, in cycles of K1B_PERF_HOST_FREQ.
+ */
+static uint64_t k1b_perf_clock(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return ((uint64_t) t.tv_sec*K1B_PERF_HOST_FREQ*1000000 + ((uint64_t) t.tv_nsec*K1B_PERF_HOST_FREQ)/1000);
+}
+
+/**
+ * @brief Opens a Linux perf counter for the calling thread.
+ *
+ * @param event Target event.
+ *
+ * @returns Upon successful completion, a file descriptor is returned.
+ * Upon failure, a negative number is returned instead.
+ */
+static int k1b_perf_open(int event)
+{
+	struct perf_event_attr attr;
+
+	if (events[event].type == PERF_TYPE_MAX)
+		return (-1);
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = events[event].type;
+	attr.config = events[event].config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return ((int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+/**
+ * @brief Reads the current value of a performance monitor.
+ *
+ * @param m Target performance monitor.
+ */
+static uint64_t k1b_perf_sample(struct k1b_perf_monitor *m)
+{
+	uint64_t value;
+
+	if (m->event == K1B_PERF_CYCLES)
+		return (k1b_perf_clock() - m->start);
+
+	if ((m->fd < 0) || (read(m->fd, &value, sizeof(value)) != sizeof(value)))
+		return (0);
+
+	return (value);
+}
+
+/**
+ * The k1b_perf_start() function starts watching for the @p event
+ * using the performance monitor @p perf.
+ */
+int k1b_perf_start(int perf, int event)
+{
+	struct k1b_perf_monitor *m;
+
+	/* Invalid performance monitor. */
+	if (!k1b_perf_monitor_is_valid(perf))
+		return (-EINVAL);
+
+	/* Invalid event. */
+	if (!k1b_perf_event_is_valid(event))
+		return (-EINVAL);
+
+	m = &monitors[perf];
+
+	/* Reopen counter only if the event changes. */
+	if (m->event != event)
+	{
+		if (m->fd >= 0)
+			close(m->fd);
+
+		m->event = event;
+		m->fd = k1b_perf_open(event);
+	}
+
+	m->value = 0;
+	m->running = true;
+
+	if (m->fd >= 0)
+	{
+		ioctl(m->fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(m->fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	m->start = k1b_perf_clock();
+
+	return (0);
+}
+
+/**
+ * The k1b_perf_stop() function stops the performance monitor @p perf.
+ */
+int k1b_perf_stop(int perf)
+{
+	struct k1b_perf_monitor *m;
+
+	/* Invalid performance monitor. */
+	if (!k1b_perf_monitor_is_valid(perf))
+		return (-EINVAL);
+
+	m = &monitors[perf];
+
+	if (!m->running)
+		return (0);
+
+	m->value = k1b_perf_sample(m);
+	m->running = false;
+
+	if (m->fd >= 0)
+		ioctl(m->fd, PERF_EVENT_IOC_DISABLE, 0);
+
+	return (0);
+}
+
+/**
+ * The k1b_perf_read() function reads the performance monitor @p perf.
+ */
+uint64_t k1b_perf_read(int perf)
+{
+	struct k1b_perf_monitor *m;
+
+	/* Invalid performance monitor. */
+	if (!k1b_perf_monitor_is_valid(perf))
+		return (K1B_PERF_INVALID);
+
+	m = &monitors[perf];
+
+	return (m->running ? k1b_perf_sample(m) : m->value);
+}
+
+/**
+ * @brief Slot of the calling thread in per-core data.
+ */
+static __thread int core = 0;
+
+/**
+ * The k1b_perf_core_set() function sets the slot of the calling thread
+ * in per-core data to @p id.
+ */
+void k1b_perf_core_set(int id)
+{
+	core = id % K1B_PERF_CORES_NUM;
+}
+
+/**
+ * The k1b_perf_core_id() function returns the ID of the underlying
+ * core.
+ */
+int k1b_perf_core_id(void)
+{
+	return (core);
+}
+
+/**
+ * The k1b_perf_timestamp() function reads the timestamp of the
+ * cluster.
+ */
+uint64_t k1b_perf_timestamp(void)
+{
+	return (k1b_perf_clock());
+}
+
+/**
+ * The k1b_perf_setup() function initializes performance monitors of
+ * the calling thread.
+ */
+void k1b_perf_setup(void)
+{
+	for (int i = 0; i < K1B_PERF_MONITORS_NUM; i++)
+		k1b_perf_stop(i);
+}
@@ -0,0 +1,242 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2019 Pedro Henrique Penna <pedrohenriquepenna@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <k1b-perf.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Stack frame of an active profiling region.
+ */
+struct k1b_perf_frame
+{
+	int region;        /**< Region.                             */
+	uint64_t start;    /**< Counter value when entering.        */
+	uint64_t children; /**< Events counted in nested regions.   */
+};
+
+/**
+ * @brief Profiling regions of a core.
+ *
+ * Each core owns a cache-line aligned slot, thus cores never write to
+ * the same cache line.
+ */
+static struct k1b_perf_core
+{
+	int top;                                              /**< Stack Top     */
+	struct k1b_perf_frame stack[K1B_PERF_REGIONS_DEPTH];  /**< Active Frames */
+	struct k1b_perf_region regions[K1B_PERF_REGIONS_NUM]; /**< Statistics    */
+} __attribute__((aligned(64))) cores[K1B_PERF_CORES_NUM];
+
+/**
+ * @brief Names of profiling regions.
+ */
+static const char *names[K1B_PERF_REGIONS_NUM];
+
+/**
+ * @brief Asserts a valid profiling region.
+ *
+ * @param region Region to assert.
+ *
+ * @returns True if the profiling region is valid and false
+ * otherwise.
+ */
+static __inline__ bool k1b_perf_region_is_valid(int region)
+{
+	return ((region >= 0) && (region < K1B_PERF_REGIONS_NUM));
+}
+
+/**
+ * @brief Asserts a valid core.
+ *
+ * @param core Core to assert.
+ *
+ * @returns True if the core is valid and false otherwise.
+ */
+static __inline__ bool k1b_perf_core_is_valid(int core)
+{
+	return ((core >= 0) && (core < K1B_PERF_CORES_NUM));
+}
+
+/**
+ * The k1b_perf_region_clear() function clears all profiling regions
+ * of the core @p core.
+ */
+int k1b_perf_region_clear(int core)
+{
+	struct k1b_perf_core *c;
+
+	/* Invalid core. */
+	if (!k1b_perf_core_is_valid(core))
+		return (-EINVAL);
+
+	c = &cores[core];
+
+	c->top = 0;
+	for (int i = 0; i < K1B_PERF_REGIONS_NUM; i++)
+	{
+		c->regions[i].inclusive = 0;
+		c->regions[i].exclusive = 0;
+		c->regions[i].count = 0;
+	}
+
+	return (0);
+}
+
+/**
+ * The k1b_perf_region_setup() function starts the performance monitor
+ * K1B_PERF_PM_2_3 watching for @p event and clears all profiling
+ * regions of the underlying core. The monitor is not reset afterwards,
+ * thus regions may nest.
+ */
+int k1b_perf_region_setup(int event)
+{
+	int ret;
+
+	if ((ret = k1b_perf_start(K1B_PERF_PM_2_3, event)) < 0)
+		return (ret);
+
+	return (k1b_perf_region_clear(k1b_perf_core_id()));
+}
+
+/**
+ * The k1b_perf_region_register() function names the profiling region
+ * @p region as @p name.
+ */
+int k1b_perf_region_register(int region, const char *name)
+{
+	/* Invalid region. */
+	if (!k1b_perf_region_is_valid(region))
+		return (-EINVAL);
+
+	names[region] = name;
+
+	return (0);
+}
+
+/**
+ * The k1b_perf_region_name() function returns the name of the
+ * profiling region @p region.
+ */
+const char *k1b_perf_region_name(int region)
+{
+	/* Invalid region. */
+	if (!k1b_perf_region_is_valid(region))
+		return (NULL);
+
+	return (names[region]);
+}
+
+/**
+ * The k1b_perf_region_begin() function enters the profiling region
+ * @p region in the underlying core.
+ */
+int k1b_perf_region_begin(int region)
+{
+	struct k1b_perf_core *c;
+	struct k1b_perf_frame *f;
+
+	/* Invalid region. */
+	if (!k1b_perf_region_is_valid(region))
+		return (-EINVAL);
+
+	c = &cores[k1b_perf_core_id()];
+
+	/* Too many nested regions. */
+	if (c->top >= K1B_PERF_REGIONS_DEPTH)
+		return (-EAGAIN);
+
+	f = &c->stack[c->top++];
+	f->region = region;
+	f->children = 0;
+	f->start = k1b_perf_read(K1B_PERF_PM_2_3);
+
+	return (0);
+}
+
+/**
+ * The k1b_perf_region_end() function leaves the profiling region
+ * @p region in the underlying core. Events counted in it are
+ * accumulated in the region, and they are discounted from the
+ * exclusive count of the enclosing region.
+ */
+int k1b_perf_region_end(int region)
+{
+	uint64_t now;
+	uint64_t elapsed;
+	struct k1b_perf_core *c;
+	struct k1b_perf_frame *f;
+
+	now = k1b_perf_read(K1B_PERF_PM_2_3);
+
+	/* Invalid region. */
+	if (!k1b_perf_region_is_valid(region))
+		return (-EINVAL);
+
+	c = &cores[k1b_perf_core_id()];
+
+	/* Not the innermost region. */
+	if ((c->top == 0) || (c->stack[c->top - 1].region != region))
+		return (-EINVAL);
+
+	f = &c->stack[--c->top];
+	elapsed = now - f->start;
+
+	c->regions[region].inclusive += elapsed;
+	c->regions[region].exclusive += elapsed - f->children;
+	c->regions[region].count++;
+
+	if (c->top > 0)
+		c->stack[c->top - 1].children += elapsed;
+
+	return (0);
+}
+
+/**
+ * The k1b_perf_region_read() function reads the statistics of the
+ * profiling region @p region in the core @p core.
+ */
+int k1b_perf_region_read(int core, int region, struct k1b_perf_region *stats)
+{
+	/* Invalid core. */
+	if (!k1b_perf_core_is_valid(core))
+		return (-EINVAL);
+
+	/* Invalid region. */
+	if (!k1b_perf_region_is_valid(region))
+		return (-EINVAL);
+
+	/* Invalid store location. */
+	if (stats == NULL)
+		return (-EINVAL);
+
+	stats->inclusive = cores[core].regions[region].inclusive;
+	stats->exclusive = cores[core].regions[region].exclusive;
+	stats->count = cores[core].regions[region].count;
+
+	return (0);
+}
@@ -22,18 +22,63 @@
 	#include <config.h>
 	#include <const.h>
 
+	#include <pthread.h>
+
 	/**
 	 * @brief Number of events to profile.
 	 */
 	#define BENCHMARK_PERF_EVENTS K1B_PERF_EVENTS_NUM
 
+	/**
+	 * @name Indexes of Performance Events in k1b_perf_events[]
+	 */
+	/**@{*/
+	#define BENCHMARK_PERF_CYCLES          0 /**< Timer Cycles                    */
+	#define BENCHMARK_PERF_ICACHE_HITS     1 /**< Instruction Cache Hits          */
+	#define BENCHMARK_PERF_ICACHE_MISSES   2 /**< Instruction Cache Misses        */
+	#define BENCHMARK_PERF_ICACHE_STALLS   3 /**< Instruction Cache Misses Stalls */
+	#define BENCHMARK_PERF_DCACHE_HITS     4 /**< Data Cache Hits                 */
+	#define BENCHMARK_PERF_DCACHE_MISSES   5 /**< Data Cache Misses               */
+	#define BENCHMARK_PERF_DCACHE_STALLS   6 /**< Data Cache Misses Stalls        */
+	#define BENCHMARK_PERF_BUNDLES         7 /**< Bundles Executed                */
+	#define BENCHMARK_PERF_BRANCH_TAKEN    8 /**< Branches Taken                  */
+	#define BENCHMARK_PERF_BRANCH_STALLS   9 /**< Branches Stalled                */
+	#define BENCHMARK_PERF_REG_STALLS     10 /**< Register Dependence Stalls      */
+	#define BENCHMARK_PERF_ITLB_STALLS    11 /**< Instruction TLB Stalls          */
+	#define BENCHMARK_PERF_DTLB_STALLS    12 /**< Data TLB Stalls                 */
+	#define BENCHMARK_PERF_STREAM_STALLS  13 /**< Stream Buffer Stalls            */
+	/**@}*/
+
+	/**
+	 * @brief Declares per-thread storage, in which the data of each
+	 * thread lies in cache lines of its own.
+	 *
+	 * @param type     Type of the data of a thread.
+	 * @param name     Name of the storage.
+	 * @param nthreads Number of threads.
+	 */
+	#define PERTHREAD(type, name, nthreads)                  \
+		union                                                \
+		{                                                    \
+			type data;                                       \
+			char pad[CACHE_LINE_ROUNDUP(sizeof(type))];      \
+		} name[nthreads] ALIGN(CACHE_LINE_SIZE)
+
+	/**
+	 * @brief Gets the data of a thread in per-thread storage.
+	 *
+	 * @param name Name of the storage.
+	 * @param tnum Thread number.
+	 */
+	#define PERTHREAD_GET(name, tnum) (&(name)[tnum].data)
+
 	/**
 	 * @brief Seed for pseudo-random number generator.
 	 */
 	#define SEED 12345
 
 	/**
-	 * @brief Random number generator state.
+	 * @brief Random number generator state (multiply-with-carry).
 	 */
 	struct rng_state
 	{
@@ -41,6 +86,14 @@
 		unsigned z;
 	};
 
+	/**
+	 * @brief Random number stream state.
+	 */
+	struct rng_stream
+	{
+		uint32_t s[4];
+	};
+
 	/**
 	 * @brief Computes the square root of a number.
 	 *
@@ -50,6 +103,15 @@
 	 */
 	extern double squared(double n);
 
+	/**
+	 * @brief Computes the reciprocal square root of a number.
+	 *
+	 * @param n Number.
+	 *
+	 * @returns The reciprocal square root of @param n.
+	 */
+	extern double rsquared(double n);
+
 	/**
 	 * @brief Raises a number to a power.
 	 *
@@ -60,6 +122,15 @@
 	 */
 	extern double powerd(double x, int y);
 
+	/**
+	 * @brief Raises e to a power.
+	 *
+	 * @param x Power.
+	 *
+	 * @returns e^x.
+	 */
+	extern double exponential(double x);
+
 	/**
 	 * @brief Initializes the pseudo-random number generator.
 	 *
@@ -76,6 +147,626 @@
 	 */
 	extern unsigned rng_next(struct rng_state *state);
 
+	/**
+	 * @brief Initializes a pseudo-random number stream.
+	 *
+	 * Streams with the same seed and different identifiers are
+	 * independent, and each stream is reproducible.
+	 *
+	 * @param stream Store location for the state of the stream.
+	 * @param seed   Seed.
+	 * @param id     Stream identifier (e.g. thread number).
+	 */
+	extern void rng_stream_initialize(struct rng_stream *stream, unsigned seed, int id);
+
+	/**
+	 * @brief Advances a pseudo-random number stream by 2^64 numbers.
+	 *
+	 * @param stream State of the stream.
+	 */
+	extern void rng_stream_jump(struct rng_stream *stream);
+
+	/**
+	 * @brief Returns a pseudo-random number of a stream.
+	 *
+	 * @param stream State of the stream.
+	 *
+	 * @returns A pseudo-random number.
+	 */
+	extern unsigned rng_stream_next(struct rng_stream *stream);
+
+	/**
+	 * @brief Fills a buffer with pseudo-random numbers of a stream.
+	 *
+	 * @param stream State of the stream.
+	 * @param buf    Target buffer.
+	 * @param n      Number of elements in @p buf.
+	 */
+	extern void rng_stream_fill(struct rng_stream *stream, unsigned *buf, int n);
+
+	/**
+	 * @brief Metrics derived from performance events.
+	 *
+	 * Stalls are given as a fraction of cycles.
+	 */
+	struct perf_metrics
+	{
+		double bpc;               /**< Bundles per Cycle                */
+		double icache_miss_ratio; /**< Instruction Cache Miss Ratio     */
+		double dcache_miss_ratio; /**< Data Cache Miss Ratio            */
+		double icache_stalls;     /**< Instruction Cache Miss Stalls    */
+		double dcache_stalls;     /**< Data Cache Miss Stalls           */
+		double branch_stalls;     /**< Branch Stalls                    */
+		double reg_stalls;        /**< Register Dependence Stalls       */
+		double itlb_stalls;       /**< Instruction TLB Stalls           */
+		double dtlb_stalls;       /**< Data TLB Stalls                  */
+		double stream_stalls;     /**< Stream Buffer Stalls             */
+		double other;             /**< Cycles Not Accounted For         */
+		const char *bound;        /**< What Bounds Performance          */
+	};
+
+	/**
+	 * @brief Computes metrics derived from performance events.
+	 *
+	 * @param metrics Store location for derived metrics.
+	 * @param stats   Performance events, as in k1b_perf_events[].
+	 */
+	extern void perf_metrics_compute(struct perf_metrics *metrics, const uint64_t *stats);
+
+	/**
+	 * @brief Dumps metrics derived from performance events.
+	 *
+	 * @param prefix   Prefix of output line.
+	 * @param it       Benchmark iteration.
+	 * @param nthreads Number of working threads.
+	 * @param stats    Performance events, as in k1b_perf_events[].
+	 */
+	extern void perf_metrics_dump(const char *prefix, int it, int nthreads, const uint64_t *stats);
+
+	/**
+	 * @brief Length of a string with formatted performance events.
+	 */
+	#define PERF_STATS_STRLEN (BENCHMARK_PERF_EVENTS*24)
+
+	/**
+	 * @brief Measures the instrumentation overhead.
+	 *
+	 * The overhead of each performance event is the minimum that is
+	 * counted around an empty region, with the same instrumentation
+	 * used by kernels.
+	 */
+	extern void perf_overhead_calibrate(void);
+
+	/**
+	 * @brief Subtracts the instrumentation overhead.
+	 *
+	 * @param event Index of target event in k1b_perf_events[].
+	 * @param raw   Raw value of the event.
+	 *
+	 * @returns The value of the event without instrumentation
+	 * overhead.
+	 */
+	extern uint64_t perf_overhead_subtract(int event, uint64_t raw);
+
+	/**
+	 * @brief Subtracts the instrumentation overhead from all events.
+	 *
+	 * @param corrected Store location for corrected events.
+	 * @param raw       Raw performance events, as in k1b_perf_events[].
+	 */
+	extern void perf_overhead_correct(uint64_t *corrected, const uint64_t *raw);
+
+	/**
+	 * @brief Dumps the instrumentation overhead.
+	 *
+	 * @param prefix Prefix of output line.
+	 */
+	extern void perf_overhead_dump(const char *prefix);
+
+	/**
+	 * @brief Checks performance events for failed or overflowed reads.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param it       Benchmark iteration.
+	 * @param nthreads Number of working threads.
+	 * @param stats    Performance events, as in k1b_perf_events[].
+	 *
+	 * @returns The number of invalid events. A warning is printed for
+	 * each one of them.
+	 */
+	extern int perf_stats_check(const char *prefix, int it, int nthreads, const uint64_t *stats);
+
+	/**
+	 * @brief Formats performance events.
+	 *
+	 * @param buf   Target buffer.
+	 * @param len   Length of target buffer.
+	 * @param stats Performance events, as in k1b_perf_events[].
+	 */
+	extern void perf_stats_format(char *buf, int len, const uint64_t *stats);
+
+	/**
+	 * @brief Records the execution time of a thread.
+	 *
+	 * @param tnum   Thread number.
+	 * @param it     Benchmark iteration.
+	 * @param cycles Raw cycles spent by the thread in the iteration.
+	 */
+	extern void scaling_sample(int tnum, int it, uint64_t cycles);
+
+	/**
+	 * @brief Records the parallel execution time of a number of
+	 * threads, from their samples.
+	 *
+	 * @param nthreads Number of working threads.
+	 *
+	 * @returns The parallel execution time (in cycles), or zero if
+	 * threads recorded no samples.
+	 */
+	extern uint64_t scaling_record(int nthreads);
+
+	/**
+	 * @brief Dumps speedup, parallel efficiency, Karp-Flatt metric and
+	 * Amdahl/Gustafson fits of a sweep on the number of threads.
+	 *
+	 * @param prefix Prefix of output lines.
+	 */
+	extern void scaling_dump(const char *prefix);
+
+	/**
+	 * @name Placement Policies of Working Threads
+	 */
+	/**@{*/
+	#define AFFINITY_NONE    0 /**< Left to the Operating System      */
+	#define AFFINITY_COMPACT 1 /**< SMT Siblings and Cores First      */
+	#define AFFINITY_SCATTER 2 /**< Spread over NUMA Nodes and Cores  */
+	#define AFFINITY_LIST    3 /**< Explicit List in AFFINITY_CPUS    */
+	/**@}*/
+
+	/**
+	 * @brief Creates a working thread, placed according to
+	 * AFFINITY_POLICY.
+	 *
+	 * @param tid  Store location for the ID of the thread.
+	 * @param tnum Thread number.
+	 * @param fn   Start routine.
+	 * @param arg  Argument of @p fn.
+	 *
+	 * @returns As pthread_create().
+	 */
+	extern int affinity_thread_create(pthread_t *tid, int tnum, void *(*fn)(void *), void *arg);
+
+	/**
+	 * @brief Places the calling thread where working thread @p tnum
+	 * is placed by affinity_thread_create().
+	 *
+	 * @param tnum Thread number.
+	 */
+	extern void affinity_thread_pin(int tnum);
+
+	/**
+	 * @brief Dumps the placement of working threads.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param nthreads Number of working threads.
+	 */
+	extern void affinity_dump(const char *prefix, int nthreads);
+
+	/**
+	 * @brief Dumps the roofline point of a kernel.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param nthreads Number of working threads.
+	 * @param flops    Floating point operations of all threads.
+	 * @param bytes    Compulsory memory traffic of all threads (in bytes),
+	 *                 or zero for kernels that are compute only.
+	 * @param cycles   Parallel execution time (in cycles).
+	 */
+	extern void roofline_dump(const char *prefix, int nthreads, double flops, double bytes, uint64_t cycles);
+
+	/**
+	 * @name Transport Limits
+	 */
+	/**@{*/
+	#define TRANSPORT_CLUSTERS_MAX 16                     /**< Maximum Number of Workers       */
+	#define TRANSPORT_MASTER       TRANSPORT_CLUSTERS_MAX /**< Endpoint of the Master          */
+	#define TRANSPORT_SLOTS_MAX    64                     /**< Inbox Slots per Endpoint        */
+	#define TRANSPORT_REQUESTS_MAX 16                     /**< Writes in Flight per Endpoint   */
+	/**@}*/
+
+	/**
+	 * @brief Spawns workers. On the MPPA-256, they run @p binary in
+	 * compute clusters. On Linux hosts, they run @p worker in child
+	 * processes.
+	 *
+	 * @param nclusters Number of workers.
+	 * @param binary    Binary of workers.
+	 * @param worker    Main routine of workers.
+	 *
+	 * @returns Zero upon success, and a negative number otherwise.
+	 */
+	extern int transport_spawn(int nclusters, const char *binary, int (*worker)(int, int));
+
+	/**
+	 * @brief Waits for workers to exit.
+	 *
+	 * @returns Zero if all workers exited successfully, and a negative
+	 * number otherwise.
+	 */
+	extern int transport_join(void);
+
+	/**
+	 * @brief Runs a worker spawned from @p binary.
+	 *
+	 * @param argc   Argument count of main().
+	 * @param argv   Argument vector of main().
+	 * @param worker Main routine of workers.
+	 *
+	 * @returns The return value of @p worker.
+	 */
+	extern int transport_worker(int argc, char **argv, int (*worker)(int, int));
+
+	/**
+	 * @brief Opens an inbox slot of the caller. Slots must be opened
+	 * before a barrier that precedes the first write into them. On
+	 * compute clusters, slots are allocated from the arena.
+	 *
+	 * @param slot Slot number.
+	 * @param size Size of the slot (in bytes).
+	 *
+	 * @returns The buffer of the slot, or NULL upon failure.
+	 */
+	extern void *transport_open(int slot, size_t size);
+
+	/**
+	 * @brief Closes all inbox slots of the caller, once its writes
+	 * complete.
+	 */
+	extern void transport_close(void);
+
+	/**
+	 * @brief Starts a write into an inbox slot of another endpoint.
+	 * The source buffer must not change until the write completes.
+	 *
+	 * @param endpoint Target endpoint.
+	 * @param slot     Target slot.
+	 * @param buf      Source buffer.
+	 * @param size     Number of bytes to write.
+	 * @param offset   Offset in the target slot.
+	 *
+	 * @returns A write request, or a negative number upon failure.
+	 */
+	extern int transport_send(int endpoint, int slot, const void *buf, size_t size, size_t offset);
+
+	/**
+	 * @brief Waits for a write to complete.
+	 *
+	 * @param req Target write request.
+	 */
+	extern void transport_send_wait(int req);
+
+	/**
+	 * @brief Waits for all writes of the caller to complete.
+	 */
+	extern void transport_flush(void);
+
+	/**
+	 * @brief Waits for one write into an inbox slot of the caller. A
+	 * slot holds one notification at most, thus senders must not write
+	 * twice into a slot before the receiver waits.
+	 *
+	 * @param slot Target slot.
+	 */
+	extern void transport_wait(int slot);
+
+	/**
+	 * @brief Waits for the master and all workers.
+	 */
+	extern void transport_barrier(void);
+
+	/**
+	 * @name Store Limits
+	 */
+	/**@{*/
+	#define STORE_BUFFERS_MAX   8         /**< Staging Buffers               */
+	#define STORE_TRANSFER_MAX  (64*1024) /**< Largest Transfer (in bytes)   */
+	/**@}*/
+
+	/**
+	 * @brief Allocates a staging buffer. Staging buffers are allocated
+	 * before the backing store is opened.
+	 *
+	 * @param id   Buffer number.
+	 * @param size Size of the buffer (in bytes).
+	 *
+	 * @returns The staging buffer, or NULL upon failure.
+	 */
+	extern void *store_buffer(int id, size_t size);
+
+	/**
+	 * @brief Opens the backing store. On compute clusters of the
+	 * MPPA-256, the IO cluster must be serving it.
+	 *
+	 * @param size Size of the backing store (in bytes).
+	 *
+	 * @returns Zero upon success, and a negative number otherwise.
+	 */
+	extern int store_open(size_t size);
+
+	/**
+	 * @brief Closes the backing store and releases staging buffers.
+	 */
+	extern void store_close(void);
+
+	/**
+	 * @brief Starts a read from the backing store into a staging
+	 * buffer. Transfers are not thread-safe.
+	 *
+	 * @param id     Target staging buffer.
+	 * @param offset Offset in the backing store.
+	 * @param size   Number of bytes to read.
+	 *
+	 * @returns A transfer request, or a negative number upon failure.
+	 */
+	extern int store_get(int id, size_t offset, size_t size);
+
+	/**
+	 * @brief Starts a write from a staging buffer to the backing
+	 * store. The buffer must not change until the write completes.
+	 *
+	 * @param id     Source staging buffer.
+	 * @param offset Offset in the backing store.
+	 * @param size   Number of bytes to write.
+	 *
+	 * @returns A transfer request, or a negative number upon failure.
+	 */
+	extern int store_put(int id, size_t offset, size_t size);
+
+	/**
+	 * @brief Waits for a transfer to complete.
+	 *
+	 * @param req Target transfer request.
+	 */
+	extern void store_wait(int req);
+
+	/**
+	 * @brief Serves the backing store in DDR to the compute cluster
+	 * spawned by the IO cluster, until it closes the store.
+	 *
+	 * @param size Size of the backing store (in bytes).
+	 *
+	 * @returns Zero upon success, and a negative number otherwise, or
+	 * if the caller is not the IO cluster of the MPPA-256.
+	 */
+	extern int store_serve(size_t size);
+
+	/**
+	 * @brief Allocates a cache-aligned buffer from the arena. Once an
+	 * allocation fails, later ones fail too until the arena is reset,
+	 * thus checking the last one is enough. Allocations are not
+	 * thread-safe.
+	 *
+	 * @param size Size of the buffer (in bytes).
+	 *
+	 * @returns The buffer, or NULL if the arena is exhausted.
+	 */
+	extern void *arena_alloc(size_t size);
+
+	/**
+	 * @brief Releases all buffers of the arena and clears its
+	 * high-water mark. Kernels reset it before they allocate.
+	 */
+	extern void arena_reset(void);
+
+	/**
+	 * @brief Dumps the high-water mark of the arena since the last
+	 * reset.
+	 *
+	 * @param prefix Prefix of output lines.
+	 */
+	extern void arena_dump(const char *prefix);
+
+	/**
+	 * @brief Returns the high-water mark of the arena since the last
+	 * reset (in bytes).
+	 */
+	extern size_t arena_peak(void);
+
+	/**
+	 * @brief Returns a stack painted for a working thread, of
+	 * FOOTPRINT_STACK_SIZE bytes. Only FOOTPRINT builds have it.
+	 *
+	 * @param tnum Thread number.
+	 *
+	 * @returns The lowest address of the stack, or NULL upon failure.
+	 */
+	extern void *footprint_stack(int tnum);
+
+	/**
+	 * @brief Dumps static data and the high-water mark of the arena.
+	 * In FOOTPRINT builds, also dumps and clears high-water marks of
+	 * stacks of working threads. The stack of the master thread is
+	 * not measured.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param nthreads Number of working threads.
+	 */
+	extern void footprint_dump(const char *prefix, int nthreads);
+
+	/**
+	 * @brief Dumps the runtime overhead of the OpenMP variant of a
+	 * kernel over its pthread variant, and discards profiling regions
+	 * entered by both variants.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param nthreads Number of working threads.
+	 * @param pthreads Execution time of the pthread variant (in cycles).
+	 * @param openmp   Execution time of the OpenMP variant (in cycles).
+	 */
+	extern void openmp_dump(const char *prefix, int nthreads, uint64_t pthreads, uint64_t openmp);
+
+	/**
+	 * @name Variants of a Kernel
+	 */
+	/**@{*/
+	#define OPENMP_PTHREADS  0 /**< Hand-Rolled pthread Variant */
+	#define OPENMP_OPENMP    1 /**< OpenMP Variant              */
+	#define OPENMP_NVARIANTS 2 /**< Number of Variants          */
+	/**@}*/
+
+	/**
+	 * @brief Variant that runs in a pass of an iteration. Variants
+	 * take turns in running first, so that none of them always finds
+	 * caches warmed by the other.
+	 *
+	 * @param it   Iteration.
+	 * @param pass Pass of the iteration.
+	 */
+	#define OPENMP_VARIANT(it, pass) (((it) + (pass)) % OPENMP_NVARIANTS)
+
+	/**
+	 * @brief Places the threads of OpenMP teams as working threads
+	 * of the pthread variant are placed, each with per-core data of
+	 * its own.
+	 *
+	 * @param nthreads Number of threads in a team.
+	 */
+	extern void openmp_bind(int nthreads);
+
+	/**
+	 * @brief Maximum number of parameters in a search.
+	 */
+	#define TUNE_PARAMS_MAX 8
+
+	/**
+	 * @brief Parameter of a kernel searched by the tuner.
+	 */
+	struct tune_param
+	{
+		const char *name; /**< Name           */
+		int min;          /**< Minimum Value  */
+		int max;          /**< Maximum Value  */
+		int step;         /**< Step           */
+		int value;        /**< Current Value  */
+	};
+
+	/**
+	 * @brief Searches the fastest configuration of a kernel, with a
+	 * grid and then hill climbing, for TUNE_BUDGET seconds at most.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param size     Problem size.
+	 * @param nthreads Number of working threads.
+	 * @param params   Parameters, set to the fastest configuration
+	 *                 upon return.
+	 * @param nparams  Number of parameters.
+	 * @param evaluate Runs the kernel on @p nthreads threads with the
+	 *                 current values of @p params and returns its
+	 *                 execution time (in cycles).
+	 */
+	extern void tune_search(const char *prefix, int size, int nthreads, struct tune_param *params, int nparams, uint64_t (*evaluate)(int, const struct tune_param *, int));
+
+	/**
+	 * @brief Returns the value of a parameter in the tuning file for
+	 * the current target.
+	 *
+	 * @param kernel   Kernel, as the last tag of its output prefix.
+	 * @param size     Problem size.
+	 * @param nthreads Number of working threads.
+	 * @param name     Parameter.
+	 * @param value    Default value.
+	 *
+	 * @returns The tuned value, or @p value if there is none.
+	 */
+	extern int tune_get(const char *kernel, int size, int nthreads, const char *name, int value);
+
+	/**
+	 * @brief Dumps and clears statistics of profiling regions.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param it       Benchmark iteration.
+	 * @param nthreads Number of working threads.
+	 */
+	extern void perf_regions_dump(const char *prefix, int it, int nthreads);
+
+	/**
+	 * @brief Dumps profiling regions, if they are enabled.
+	 */
+	#ifdef K1B_PERF_REGIONS
+		#define PERF_REGIONS_DUMP(prefix, it, nthreads) perf_regions_dump(prefix, it, nthreads)
+	#else
+		#define PERF_REGIONS_DUMP(prefix, it, nthreads) ((void) 0)
+	#endif
+
+	/**
+	 * @name Phases of Trace Events
+	 */
+	/**@{*/
+	#define TRACE_PHASE_BEGIN   0 /**< Beginning of a span. */
+	#define TRACE_PHASE_END     1 /**< End of a span.       */
+	#define TRACE_PHASE_INSTANT 2 /**< Instant.             */
+	/**@}*/
+
+	/**
+	 * @brief Number of trace events.
+	 */
+	#define TRACE_EVENTS_NUM 64
+
+	/**
+	 * @brief Names a trace event.
+	 *
+	 * @param event Target event.
+	 * @param name  Name of the event.
+	 */
+	extern void trace_register(int event, const char *name);
+
+	/**
+	 * @brief Records a trace event in the buffer of the underlying
+	 * core. Events that do not fit in the buffer are dropped.
+	 *
+	 * @param event Target event.
+	 * @param phase Phase of the event.
+	 */
+	extern void trace_record(int event, int phase);
+
+	/**
+	 * @brief Discards trace events of all cores.
+	 */
+	extern void trace_clear(void);
+
+	/**
+	 * @brief Dumps and discards trace events of all cores.
+	 *
+	 * @param prefix   Prefix of output lines.
+	 * @param it       Benchmark iteration.
+	 * @param nthreads Number of working threads.
+	 */
+	extern void trace_dump(const char *prefix, int it, int nthreads);
+
+	/**
+	 * @name Tracing
+	 *
+	 * Trace events are recorded only if TRACE is defined, so they
+	 * may be left in the code at no cost.
+	 */
+	/**@{*/
+	#ifdef TRACE
+		#define TRACE_NAME(event, name)             trace_register(event, name)
+		#define TRACE_BEGIN(event)                  trace_record(event, TRACE_PHASE_BEGIN)
+		#define TRACE_END(event)                    trace_record(event, TRACE_PHASE_END)
+		#define TRACE_INSTANT(event)                trace_record(event, TRACE_PHASE_INSTANT)
+		#define TRACE_CLEAR()                       trace_clear()
+		#define TRACE_DUMP(prefix, it, nthreads)    trace_dump(prefix, it, nthreads)
+	#else
+		#define TRACE_NAME(event, name)             ((void) 0)
+		#define TRACE_BEGIN(event)                  ((void) 0)
+		#define TRACE_END(event)                    ((void) 0)
+		#define TRACE_INSTANT(event)                ((void) 0)
+		#define TRACE_CLEAR()                       ((void) 0)
+		#define TRACE_DUMP(prefix, it, nthreads)    ((void) 0)
+	#endif
+	/**@}*/
+
 	/**
 	 * Performance events.
 	 */
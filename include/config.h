@@ -32,4 +32,73 @@
 	 */
 	#define SKIP 10
 
+	/**
+	 * @brief Parallel efficiency below which a kernel is flagged as
+	 * not scaling.
+	 */
+	#define SCALING_EFFICIENCY_MIN 0.7
+
+	/**
+	 * @brief Placement policy of working threads.
+	 */
+	#ifndef AFFINITY_POLICY
+		#define AFFINITY_POLICY AFFINITY_NONE
+	#endif
+
+	/**
+	 * @brief CPUs of the explicit placement policy, in thread order.
+	 */
+	#ifndef AFFINITY_CPUS
+		#define AFFINITY_CPUS ""
+	#endif
+
+	/**
+	 * @brief Binary of compute clusters, spawned by the IO cluster.
+	 */
+	#ifndef CCLUSTER_BINARY
+		#define CCLUSTER_BINARY ""
+	#endif
+
+	/**
+	 * @brief Directory of backing store files on Linux hosts.
+	 */
+	#ifndef STORE_DIRECTORY
+		#define STORE_DIRECTORY "/tmp"
+	#endif
+
+	/**
+	 * @brief Size of the arena of kernel buffers (in bytes). On compute
+	 * clusters, it takes most of the SMEM left by code and stacks.
+	 */
+	#ifndef ARENA_SIZE
+		#if defined(__node__)
+			#define ARENA_SIZE (1280*1024)
+		#elif defined(__k1__)
+			#define ARENA_SIZE (64*1024*1024)
+		#else
+			#define ARENA_SIZE (256*1024*1024)
+		#endif
+	#endif
+
+	/**
+	 * @brief Stack size of working threads in FOOTPRINT builds (in
+	 * bytes).
+	 */
+	#ifndef FOOTPRINT_STACK_SIZE
+		#if defined(__node__)
+			#define FOOTPRINT_STACK_SIZE (8*1024)
+		#elif defined(__k1__)
+			#define FOOTPRINT_STACK_SIZE (64*1024)
+		#else
+			#define FOOTPRINT_STACK_SIZE (1024*1024)
+		#endif
+	#endif
+
+	/**
+	 * @brief Time budget of a tuning search (in seconds).
+	 */
+	#ifndef TUNE_BUDGET
+		#define TUNE_BUDGET 60
+	#endif
+
 #endif /* CONFIG_H_ */
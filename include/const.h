@@ -49,6 +49,14 @@
 	 */
 	#define UINT32(x) ((uint32_t)((x) & 0xffffffff))
 
+	/**
+	 * @brief Casts something to an unsigned long long, for printing
+	 * 64-bit values with %llu.
+	 *
+	 * @param x Something.
+	 */
+	#define UINT64(x) ((unsigned long long)(x))
+
 	/**
 	 * @brief Casts something to a float.
 	 *
@@ -56,6 +64,13 @@
 	 */
 	#define FLOAT(x) ((float)(x))
 
+	/**
+	 * @brief Casts something to a double.
+	 *
+	 * @param x Something.
+	 */
+	#define DOUBLE(x) ((double)(x))
+
 	/**
 	 * @name Math Costants
 	 */
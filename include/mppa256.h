@@ -25,10 +25,18 @@
 	 */
 	#define CLUSTER_FREQ 400
 
+	/**
+	 * @name Conversion of Cycles
+	 */
+	/**@{*/
+	#define CYCLES_TO_USECONDS(x) (DOUBLE(x)/CLUSTER_FREQ)         /**< Cycles to microseconds. */
+	#define CYCLES_TO_SECONDS(x)  (CYCLES_TO_USECONDS(x)/1000000) /**< Cycles to seconds.      */
+	/**@}*/
+
 	/**
 	 * @brief Number of cores
 	 */
-	#ifdef __node__
+	#if defined(__node__) || !defined(__k1__)
 		#define NUM_CORES 16
 	#else
 		#define NUM_CORES 4
@@ -54,14 +62,25 @@
 	 */
 	#define CACHE_SIZE (1 << CACHE_SIZE_LOG2)
 
+	/**
+	 * @brief Rounds a size up to a multiple of the cache line size.
+	 */
+	#define CACHE_LINE_ROUNDUP(x) \
+		(((x) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1))
+
 	/**
 	 * @brief Invalidates the data cache of the underlying core.
 	 */
 	static inline void dcache_invalidate(void)
 	{
+	#ifdef __k1__
 		__builtin_k1_wpurge();
 		__builtin_k1_fence();
 		__builtin_k1_dinval();
+	#else
+		/* Caches are coherent on Linux hosts. */
+		__sync_synchronize();
+	#endif
 	}
 
 #endif /* MPPA256_H_ */
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tuning file. Each entry is the best value of a kernel parameter for
+ * a target, problem size and number of working threads:
+ *
+ *   TUNING(kernel, target, size, nthreads, name, value)
+ *
+ * Entries are generated from the output of TUNE builds:
+ *
+ *   bin/tuning < logs > include/tuning.h
+ *
+ * No include guard: this file is expanded into a table.
+ */
@@ -0,0 +1,636 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Two kernels run concurrently on disjoint sets of working threads, and
+ * thus of cores, which share banks of the memory of the cluster and the
+ * NoC. Each kernel is measured solo and next to the other one, which
+ * runs in a loop for as long as the measured kernel runs.
+ *
+ * Cores have private caches, thus contention shows up as extra data
+ * cache stall cycles and stream buffer stalls. No event counts bank
+ * conflicts, but they lengthen each data cache miss. Extra stall cycles
+ * of a co-run are thus split into those of extra misses (at the solo
+ * penalty), those of a longer miss penalty (bank conflicts) and extra
+ * stream stalls, and the largest one is reported as the source of
+ * contention.
+ */
+
+#ifdef __k1__
+#include <mppa/osconfig.h>
+#endif
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MAX          (NUM_CORES - 1) /**< Working Threads of Both Kernels */
+#define NTHREADS_FIRST ((NTHREADS_MAX + 1)/2) /**< Working Threads of 1st Kernel   */
+#define NTHREADS_SECOND      (NTHREADS_MAX/2) /**< Working Threads of 2nd Kernel   */
+/**@}*/
+
+/**
+ * @name Kernel Parameters
+ */
+/**@{*/
+#define MATSIZE                     84  /**< Matrix Size             */
+#define MASKSIZE                     7  /**< Mask Size               */
+#define IMGSIZE (512 + (MASKSIZE - 1))  /**< Image Size              */
+#define NELEMENTS            (16*1024)  /**< Elements per Array      */
+#define SCALAR                     3.0  /**< Scalar of Triad         */
+#define BATCHSIZE                   64  /**< Random Numbers per Batch */
+/**@}*/
+
+/**
+ * @name Sampled Events
+ */
+/**@{*/
+#define EVENT_CYCLES        0 /**< Cycles                  */
+#define EVENT_DCACHE_MISSES 1 /**< Data Cache Misses       */
+#define EVENT_DCACHE_STALLS 2 /**< Data Cache Miss Stalls  */
+#define EVENT_STREAM_STALLS 3 /**< Stream Buffer Stalls    */
+#define NEVENTS             4 /**< Number of Events        */
+/**@}*/
+
+/**
+ * @brief Indexes of sampled events in k1b_perf_events[].
+ */
+static const int events[NEVENTS] = {
+	BENCHMARK_PERF_CYCLES,
+	BENCHMARK_PERF_DCACHE_MISSES,
+	BENCHMARK_PERF_DCACHE_STALLS,
+	BENCHMARK_PERF_STREAM_STALLS
+};
+
+/*============================================================================*
+ * Kernels                                                                    *
+ *============================================================================*/
+
+/**
+ * @name Matrices
+ */
+/**@{*/
+static float *a;
+static float *b;
+static float *ret;
+/**@}*/
+
+/**
+ * @name Images
+ */
+/**@{*/
+static double *mask;
+static unsigned char *img;
+static unsigned char *output;
+/**@}*/
+
+/**
+ * @name Arrays
+ */
+/**@{*/
+static double *x;
+static double *y;
+static double *z;
+/**@}*/
+
+/**
+ * @brief Computes the chunk of a thread.
+ *
+ * @param n        Number of items.
+ * @param tnum     Thread number.
+ * @param nthreads Number of working threads.
+ * @param i0       Store location for the start item.
+ * @param in       Store location for the end item.
+ */
+static inline void chunk(int n, int tnum, int nthreads, int *i0, int *in)
+{
+	*i0 = (n*tnum)/nthreads;
+	*in = (n*(tnum + 1))/nthreads;
+}
+
+/**
+ * @brief Multiplies a chunk of lines of the matrices.
+ */
+static void matrix(int tnum, int nthreads)
+{
+	int i0, in;
+
+	chunk(MATSIZE, tnum, nthreads, &i0, &in);
+
+	for (int i = i0; i < in; i++)
+	{
+		for (int j = 0; j < MATSIZE; j++)
+		{
+			float c = 0;
+
+			for (int k = 0; k < MATSIZE; k++)
+				c += a[i*MATSIZE + k]*b[k*MATSIZE + j];
+
+			ret[i*MATSIZE + j] = c;
+		}
+	}
+}
+
+/**
+ * @brief Filters a chunk of lines of the image.
+ */
+static void gauss_filter(int tnum, int nthreads)
+{
+	int half = MASKSIZE >> 1;
+	int i0, in;
+
+	chunk(IMGSIZE - 2*half, tnum, nthreads, &i0, &in);
+
+	for (int i = i0 + half; i < in + half; i++)
+	{
+		for (int j = half; j < IMGSIZE - half; j++)
+		{
+			double pixel = 0.0;
+
+			for (int mi = 0; mi < MASKSIZE; mi++)
+			{
+				for (int mj = 0; mj < MASKSIZE; mj++)
+					pixel += img[(i + mi - half)*IMGSIZE + (j + mj - half)]*mask[mi*MASKSIZE + mj];
+			}
+
+			output[i*IMGSIZE + j] = (pixel > 255) ? 255 : (unsigned char) pixel;
+		}
+	}
+}
+
+/**
+ * @brief Runs the triad over a chunk of the arrays.
+ */
+static void stream(int tnum, int nthreads)
+{
+	int i0, in;
+
+	chunk(NELEMENTS, tnum, nthreads, &i0, &in);
+
+	for (int i = i0; i < in; i++)
+		x[i] = y[i] + SCALAR*z[i];
+}
+
+/**
+ * @brief Kernels.
+ */
+static const struct kernel
+{
+	const char *name;                      /**< Name           */
+	void (*pass)(int tnum, int nthreads);  /**< Runs a Chunk   */
+} kernels[] = {
+	{ "matrix",       matrix       },
+	{ "gauss-filter", gauss_filter },
+	{ "stream",       stream       },
+};
+
+/**
+ * @name Kernel Indexes
+ */
+/**@{*/
+#define KERNEL_MATRIX 0 /**< Matrix Multiplication */
+#define KERNEL_GF     1 /**< Gaussian Filter       */
+#define KERNEL_STREAM 2 /**< Triad                 */
+/**@}*/
+
+/**
+ * @brief Co-schedules: the first kernel runs on the first
+ * NTHREADS_FIRST threads, and the second one on the others.
+ */
+static const struct
+{
+	int first;  /**< First Kernel  */
+	int second; /**< Second Kernel */
+} coscheds[] = {
+	{ KERNEL_MATRIX, KERNEL_GF     },
+	{ KERNEL_MATRIX, KERNEL_STREAM },
+	{ KERNEL_GF,     KERNEL_STREAM },
+};
+
+/**
+ * @brief Number of co-schedules.
+ */
+#define NCOSCHEDS ((int)(sizeof(coscheds)/sizeof(coscheds[0])))
+
+/**
+ * @brief Initializes data of all kernels.
+ *
+ * @returns Zero upon success, and a negative number if the arena is
+ * exhausted.
+ */
+static int data_init(void)
+{
+	struct rng_stream rng;
+	unsigned buf[BATCHSIZE];
+	int half = MASKSIZE >> 1;
+	double total = 0.0;
+
+	arena_reset();
+	a = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	b = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	ret = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	mask = arena_alloc(MASKSIZE*MASKSIZE*sizeof(double));
+	img = arena_alloc(IMGSIZE*IMGSIZE*sizeof(unsigned char));
+	output = arena_alloc(IMGSIZE*IMGSIZE*sizeof(unsigned char));
+	x = arena_alloc(NELEMENTS*sizeof(double));
+	y = arena_alloc(NELEMENTS*sizeof(double));
+	z = arena_alloc(NELEMENTS*sizeof(double));
+
+	if (z == NULL)
+		return (-1);
+
+	for (int i = 0; i < MATSIZE*MATSIZE; i++)
+	{
+		a[i] = 1.0;
+		b[i] = 1.0;
+	}
+
+	for (int i = -half; i <= half; i++)
+	{
+		for (int j = -half; j <= half; j++)
+		{
+			double value = exponential(-((i*i + j*j)/2.0*SD*SD))/(2.0*PI*SD*SD);
+
+			mask[(i + half)*MASKSIZE + (j + half)] = value;
+			total += value;
+		}
+	}
+	for (int i = 0; i < MASKSIZE*MASKSIZE; i++)
+		mask[i] /= total;
+
+	rng_stream_initialize(&rng, SEED, 0);
+	for (int i = 0; i < IMGSIZE*IMGSIZE; i += BATCHSIZE)
+	{
+		int n = ((IMGSIZE*IMGSIZE - i) < BATCHSIZE) ? (IMGSIZE*IMGSIZE - i) : BATCHSIZE;
+
+		rng_stream_fill(&rng, buf, n);
+
+		for (int j = 0; j < n; j++)
+			img[i + j] = buf[j] & 0xff;
+	}
+
+	for (int i = 0; i < NELEMENTS; i++)
+	{
+		x[i] = 0.0;
+		y[i] = 1.0;
+		z[i] = 2.0;
+	}
+
+	/* Working threads read it. */
+	dcache_invalidate();
+
+	return (0);
+}
+
+/*============================================================================*
+ * Co-Scheduling                                                              *
+ *============================================================================*/
+
+/**
+ * @brief Placement of a kernel.
+ */
+struct placement
+{
+	int kernel;   /**< Kernel                  */
+	int first;    /**< First Working Thread    */
+	int nthreads; /**< Number of Working Threads */
+};
+
+/**
+ * @brief Interference measured on a kernel.
+ */
+struct interference
+{
+	uint64_t cycles;          /**< Parallel Execution Time                 */
+	uint64_t total[NEVENTS];  /**< Events of All Threads and Iterations    */
+};
+
+/**
+ * @brief Task info.
+ */
+struct tdata
+{
+	int tnum;                                /**< Thread Number in its Kernel */
+	const struct placement *p;               /**< Placement of its Kernel     */
+	uint64_t stats[NITERATIONS][NEVENTS];    /**< Events of Each Iteration    */
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS_MAX);
+
+/**
+ * @name Synchronization
+ */
+/**@{*/
+static pthread_barrier_t barrier;       /**< Barrier of All Threads          */
+static pthread_barrier_t barrier_run;   /**< Barrier of the Measured Kernel  */
+static volatile int done = 0;           /**< Measured Kernel Done?           */
+/**@}*/
+
+/**
+ * @brief Runs the measured kernel.
+ */
+static void *task_measured(void *arg)
+{
+	struct tdata *t = arg;
+	const struct kernel *k = &kernels[t->p->kernel];
+
+	for (int i = 0; i < (NITERATIONS + SKIP); i++)
+	{
+		for (int j = 0; j < NEVENTS; j++)
+		{
+			uint64_t value;
+
+			/* Start with the other kernel. */
+			pthread_barrier_wait(&barrier);
+
+			k1b_perf_start(0, k1b_perf_events[events[j]]);
+
+				k->pass(t->tnum, t->p->nthreads);
+
+			k1b_perf_stop(0);
+
+			value = k1b_perf_read(0);
+
+			if (i >= SKIP)
+				t->stats[i - SKIP][j] = perf_overhead_subtract(events[j], value);
+
+			/* Stop the other kernel. */
+			pthread_barrier_wait(&barrier_run);
+			if (t->tnum == 0)
+			{
+				done = 1;
+				dcache_invalidate();
+			}
+
+			pthread_barrier_wait(&barrier);
+			if (t->tnum == 0)
+				done = 0;
+		}
+	}
+
+	/* Master reads it. */
+	dcache_invalidate();
+
+	return (NULL);
+}
+
+/**
+ * @brief Runs the other kernel in a loop.
+ */
+static void *task_background(void *arg)
+{
+	struct tdata *t = arg;
+	const struct kernel *k = &kernels[t->p->kernel];
+
+	for (int i = 0; i < (NITERATIONS + SKIP); i++)
+	{
+		for (int j = 0; j < NEVENTS; j++)
+		{
+			pthread_barrier_wait(&barrier);
+
+			do
+			{
+				k->pass(t->tnum, t->p->nthreads);
+				dcache_invalidate();
+			} while (!done);
+
+			pthread_barrier_wait(&barrier);
+		}
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Measures a kernel, solo or next to another one.
+ *
+ * @param r        Store location for the interference.
+ * @param measured Placement of the measured kernel.
+ * @param other    Placement of the other kernel, or NULL to run solo.
+ */
+static void cosched_run(struct interference *r, const struct placement *measured, const struct placement *other)
+{
+	int nthreads;
+	pthread_t tid[NTHREADS_MAX];
+
+	nthreads = measured->nthreads + ((other != NULL) ? other->nthreads : 0);
+
+	pthread_barrier_init(&barrier, NULL, nthreads);
+	pthread_barrier_init(&barrier_run, NULL, measured->nthreads);
+
+	/* Spawn threads on the cores of each kernel. */
+	for (int i = 0; i < measured->nthreads; i++)
+	{
+		struct tdata *t = PERTHREAD_GET(tdata, measured->first + i);
+
+		t->tnum = i;
+		t->p = measured;
+
+		affinity_thread_create(&tid[measured->first + i], measured->first + i, task_measured, t);
+	}
+	for (int i = 0; (other != NULL) && (i < other->nthreads); i++)
+	{
+		struct tdata *t = PERTHREAD_GET(tdata, other->first + i);
+
+		t->tnum = i;
+		t->p = other;
+
+		affinity_thread_create(&tid[other->first + i], other->first + i, task_background, t);
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < measured->nthreads; i++)
+		pthread_join(tid[measured->first + i], NULL);
+	for (int i = 0; (other != NULL) && (i < other->nthreads); i++)
+		pthread_join(tid[other->first + i], NULL);
+
+	pthread_barrier_destroy(&barrier_run);
+	pthread_barrier_destroy(&barrier);
+
+	/* Task info was written by other cores. */
+	dcache_invalidate();
+
+	/* The slowest thread gives the parallel time. */
+	r->cycles = UINT64_MAX;
+	for (int j = 0; j < NEVENTS; j++)
+		r->total[j] = 0;
+
+	for (int it = 0; it < NITERATIONS; it++)
+	{
+		uint64_t slowest = 0;
+
+		for (int i = 0; i < measured->nthreads; i++)
+		{
+			struct tdata *t = PERTHREAD_GET(tdata, measured->first + i);
+
+			if (t->stats[it][EVENT_CYCLES] > slowest)
+				slowest = t->stats[it][EVENT_CYCLES];
+
+			for (int j = 0; j < NEVENTS; j++)
+				r->total[j] += t->stats[it][j];
+		}
+
+		if (slowest < r->cycles)
+			r->cycles = slowest;
+	}
+}
+
+/**
+ * @brief Computes a ratio, guarding against empty denominators.
+ */
+static inline double ratio(uint64_t n, uint64_t d)
+{
+	return ((d == 0) ? 0.0 : DOUBLE(n)/DOUBLE(d));
+}
+
+/**
+ * @brief Dumps the interference of a kernel.
+ *
+ * @param measured Placement of the measured kernel.
+ * @param other    Placement of the other kernel.
+ * @param solo     Interference when running solo.
+ * @param corun    Interference when running next to @p other.
+ */
+static void cosched_dump(
+	const struct placement *measured,
+	const struct placement *other,
+	const struct interference *solo,
+	const struct interference *corun
+)
+{
+	double slowdown;
+	double penalty[2];
+	double extra[3];
+	const char *source = "none";
+	static const char *sources[3] = { "dcache", "banks", "stream" };
+
+	slowdown = ratio(corun->cycles, solo->cycles);
+
+	/* Stall cycles per data cache miss. */
+	penalty[0] = ratio(solo->total[EVENT_DCACHE_STALLS], solo->total[EVENT_DCACHE_MISSES]);
+	penalty[1] = ratio(corun->total[EVENT_DCACHE_STALLS], corun->total[EVENT_DCACHE_MISSES]);
+
+	/* Extra stall cycles of the co-run, by source. */
+	extra[0] = (DOUBLE(corun->total[EVENT_DCACHE_MISSES]) - DOUBLE(solo->total[EVENT_DCACHE_MISSES]))*penalty[0];
+	extra[1] = DOUBLE(corun->total[EVENT_DCACHE_MISSES])*(penalty[1] - penalty[0]);
+	extra[2] = DOUBLE(corun->total[EVENT_STREAM_STALLS]) - DOUBLE(solo->total[EVENT_STREAM_STALLS]);
+
+	for (int i = 0, largest = -1; i < 3; i++)
+	{
+		if ((extra[i] > 0.0) && ((largest < 0) || (extra[i] > extra[largest])))
+		{
+			largest = i;
+			source = sources[i];
+		}
+	}
+
+#ifdef NDEBUG
+	printf("%s %s %d %s %d %llu %llu %.3f %.4f %.4f %.4f %.4f %.2f %.2f %s\n",
+		"[benchmarks][cosched]",
+		kernels[measured->kernel].name,
+		measured->nthreads,
+		kernels[other->kernel].name,
+		other->nthreads,
+		UINT64(solo->cycles),
+		UINT64(corun->cycles),
+		slowdown,
+		ratio(solo->total[EVENT_DCACHE_STALLS], solo->total[EVENT_CYCLES]),
+		ratio(corun->total[EVENT_DCACHE_STALLS], corun->total[EVENT_CYCLES]),
+		ratio(solo->total[EVENT_STREAM_STALLS], solo->total[EVENT_CYCLES]),
+		ratio(corun->total[EVENT_STREAM_STALLS], corun->total[EVENT_CYCLES]),
+		penalty[0],
+		penalty[1],
+		source
+	);
+#else
+	printf("%s kernel=%s nthreads=%d    other=%s nthreads=%d    solo=%.2f us    corun=%.2f us    slowdown=%.2fx    "
+		"stalls: dmiss=%.1f%%->%.1f%% stream=%.1f%%->%.1f%%    miss-penalty=%.1f->%.1f cycles    source=%s\n",
+		"[benchmarks][cosched]",
+		kernels[measured->kernel].name,
+		measured->nthreads,
+		kernels[other->kernel].name,
+		other->nthreads,
+		CYCLES_TO_USECONDS(solo->cycles),
+		CYCLES_TO_USECONDS(corun->cycles),
+		slowdown,
+		100*ratio(solo->total[EVENT_DCACHE_STALLS], solo->total[EVENT_CYCLES]),
+		100*ratio(corun->total[EVENT_DCACHE_STALLS], corun->total[EVENT_CYCLES]),
+		100*ratio(solo->total[EVENT_STREAM_STALLS], solo->total[EVENT_CYCLES]),
+		100*ratio(corun->total[EVENT_STREAM_STALLS], corun->total[EVENT_CYCLES]),
+		penalty[0],
+		penalty[1],
+		source
+	);
+#endif
+}
+
+/**
+ * @brief Co-Scheduling Interference Benchmark Kernel
+ *
+ * @param first  First kernel.
+ * @param second Second kernel.
+ */
+static void kernel_cosched(int first, int second)
+{
+	struct interference solo;
+	struct interference corun;
+	struct placement p[2] = {
+		{ first,  0,              NTHREADS_FIRST  },
+		{ second, NTHREADS_FIRST, NTHREADS_SECOND },
+	};
+
+	for (int i = 0; i < 2; i++)
+	{
+		cosched_run(&solo, &p[i], NULL);
+		cosched_run(&corun, &p[i], &p[1 - i]);
+		cosched_dump(&p[i], &p[1 - i], &solo, &corun);
+	}
+}
+
+/**
+ * @brief Co-Scheduling Interference Benchmark
+ */
+int main(int argc, char **argv)
+{
+	((void) argc);
+	((void) argv);
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][cosched]");
+
+	if (data_init() < 0)
+	{
+		arena_dump("[benchmarks][cosched]");
+		return (-1);
+	}
+
+	for (int i = 0; i < NCOSCHEDS; i++)
+		kernel_cosched(coscheds[i].first, coscheds[i].second);
+
+	affinity_dump("[benchmarks][cosched]", NTHREADS_MAX);
+	footprint_dump("[benchmarks][cosched]", NTHREADS_MAX);
+
+	return (0);
+}
@@ -15,7 +15,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef __k1__
 #include <mppa/osconfig.h>
+#endif
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -29,23 +31,40 @@
 #define NTHREADS_MIN               1  /**< Minimum Number of Working Threads      */
 #define NTHREADS_MAX  (NUM_CORES - 1) /**< Maximum Number of Working Threads      */
 #define NTHREADS_STEP              1  /**< Increment on Number of Working Threads */
-#define FLOPS                (100008) /**< Number of Floating Point Operations    */
+#define FLOPS                (100008) /**< Floating Point Operations per Thread   */
+#define FLOPS_STEP                 9  /**< Operations per Iteration of fpu()      */
+/**@}*/
+
+/**
+ * @name Micro-Kernel Parameters
+ */
+/**@{*/
+#define UKERNEL_LENGTH          256 /**< Loop Iterations per Micro-Kernel          */
+#define UKERNEL_NACCUMULATORS     8 /**< Independent Accumulators in Throughput Mode */
+#define UKERNEL_OPERAND    1.000001 /**< Loop-Invariant Operand                     */
 /**@}*/
 
 /**
  * @brief Task info.
  */
-static struct tdata
+struct tdata
 {
-	int tnum;       /**< Thread Number    */
-	float scratch;  /**< Scrtch Variable  */
-} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+	int tnum;                /**< Thread Number            */
+	float scratch;           /**< Scrtch Variable          */
+	volatile double result;  /**< Result of Micro-Kernels  */
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS_MAX);
 
 /**
  * @name Benchmark Kernel Parameters
  */
 /**@{*/
-static int NTHREADS; /**< Number of Working Threads */
+static int NTHREADS; /**< Number of Working Threads            */
+static int NFLOPS;   /**< Floating Point Operations per Thread */
 /**@}*/
 
 /**
@@ -57,47 +76,52 @@ static int NTHREADS; /**< Number of Working Threads */
  */
 static inline void benchmark_dump_stats(int it, int flops, uint64_t *stats)
 {
+	uint64_t corrected[BENCHMARK_PERF_EVENTS];
+
+	perf_stats_check("[benchmarks][fpu]", it, NTHREADS, stats);
+	perf_overhead_correct(corrected, stats);
+
 #ifdef NDEBUG
-	printf("%s %d %d %d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+	char buf_raw[PERF_STATS_STRLEN];
+	char buf_corrected[PERF_STATS_STRLEN];
+
+	perf_stats_format(buf_raw, sizeof(buf_raw), stats);
+	perf_stats_format(buf_corrected, sizeof(buf_corrected), corrected);
+
+	printf("%s %d %d %d %s %s\n",
 		"[benchmarks][fpu]",
 		it,
 		NTHREADS,
 		flops,
-		UINT32(stats[0]),
-		UINT32(stats[1]),
-		UINT32(stats[2]),
-		UINT32(stats[3]),
-		UINT32(stats[4]),
-		UINT32(stats[5]),
-		UINT32(stats[6]),
-		UINT32(stats[7]),
-		UINT32(stats[8]),
-		UINT32(stats[9]),
-		UINT32(stats[10]),
-		UINT32(stats[11]),
-		UINT32(stats[12]),
-		UINT32(stats[13])
+		buf_raw,
+		buf_corrected
 	);
 #else
 	UNUSED(it);
 
-	printf("%s nthreads=%d    time=%.2f s    flops=%.2f MFLOPS\n",
+	printf("%s nthreads=%d    time=%.6f s (%.6f s corrected)    flops=%.2f MFLOPS\n",
 		"[benchmarks][fpu]",
 		NTHREADS,
-		(UINT32(stats[0])/FLOAT(CLUSTER_FREQ)),
-		flops/(UINT32(stats[0])/FLOAT(CLUSTER_FREQ))
+		CYCLES_TO_SECONDS(stats[0]),
+		CYCLES_TO_SECONDS(corrected[0]),
+		flops/CYCLES_TO_USECONDS(corrected[0])
 	);
 #endif
+
+	perf_metrics_dump("[benchmarks][fpu]", it, NTHREADS, corrected);
 }
 
 /**
  * @brief Perform FPU operations.
+ *
+ * @param scratch Scratch variable.
+ * @param flops   Number of floating point operations.
  */
-static inline int fpu(float scratch)
+static inline int fpu(float scratch, int flops)
 {
 	register float tmp = scratch;
 
-	for (int i = 0; i < FLOPS; i += 9)
+	for (int i = 0; i < flops; i += FLOPS_STEP)
 	{
 		register float k1 = i*1.1;
 		register float k2 = i*2.1;
@@ -110,6 +134,222 @@ static inline int fpu(float scratch)
 	return (tmp);
 }
 
+/*============================================================================*
+ * Micro-Kernels                                                              *
+ *============================================================================*/
+
+/**
+ * @name Micro-Kernel Operations
+ *
+ * @param x Operand that carries the dependence.
+ * @param y Loop-invariant operand.
+ */
+/**@{*/
+#define ADD(x, y)   ((x) + (y))                            /**< Addition                       */
+#define MUL(x, y)   ((x) * (y))                            /**< Multiplication                 */
+#define FMAF(x, y)  __builtin_fmaf((x), (y), (y))          /**< Fused Multiply-Add (Float)     */
+#define FMAD(x, y)  __builtin_fma((x), (y), (y))           /**< Fused Multiply-Add (Double)    */
+#define DIV(x, y)   ((x) / (y))                            /**< Division                       */
+#define SQRTF(x, y) (UNUSED(y), __builtin_sqrtf(x))        /**< Square Root (Float)            */
+#define SQRTD(x, y) (UNUSED(y), __builtin_sqrt(x))         /**< Square Root (Double)           */
+#define CVTF(x, y)  (UNUSED(y), (float)(int32_t)(x))       /**< Round Trip Conversion (Float)  */
+#define CVTD(x, y)  (UNUSED(y), (double)(int32_t)(x))      /**< Round Trip Conversion (Double) */
+/**@}*/
+
+/**
+ * @brief Generates the micro-kernels of an operation.
+ *
+ * In latency mode, each operation depends on the result of the
+ * previous one, thus the loop runs at the latency of the operation.
+ * In throughput mode, operations are spread across independent
+ * accumulators, thus the loop runs at the issue rate of the
+ * operation. Both modes perform the same number of operations.
+ *
+ * Seeds are small and the loop-invariant operand is close to one, so
+ * that operands stay finite and normal in all micro-kernels.
+ *
+ * @param name Name of the micro-kernel.
+ * @param T    Floating point type.
+ * @param OP   Operation.
+ */
+#define UKERNEL(name, T, OP)                                                \
+	static double name##_latency(double seed)                               \
+	{                                                                       \
+		register T x = (T) seed;                                            \
+		register T y = (T) UKERNEL_OPERAND;                                 \
+                                                                            \
+		for (int i = 0; i < UKERNEL_LENGTH; i++)                            \
+		{                                                                   \
+			x = OP(x, y); x = OP(x, y); x = OP(x, y); x = OP(x, y);         \
+			x = OP(x, y); x = OP(x, y); x = OP(x, y); x = OP(x, y);         \
+		}                                                                   \
+                                                                            \
+		return (x);                                                         \
+	}                                                                       \
+                                                                            \
+	static double name##_throughput(double seed)                            \
+	{                                                                       \
+		register T x0 = (T) seed, x1 = x0, x2 = x0, x3 = x0;                \
+		register T x4 = x0, x5 = x0, x6 = x0, x7 = x0;                      \
+		register T y = (T) UKERNEL_OPERAND;                                 \
+                                                                            \
+		for (int i = 0; i < UKERNEL_LENGTH; i++)                            \
+		{                                                                   \
+			x0 = OP(x0, y); x1 = OP(x1, y); x2 = OP(x2, y); x3 = OP(x3, y); \
+			x4 = OP(x4, y); x5 = OP(x5, y); x6 = OP(x6, y); x7 = OP(x7, y); \
+		}                                                                   \
+                                                                            \
+		return (x0 + x1 + x2 + x3 + x4 + x5 + x6 + x7);                     \
+	}
+
+/**
+ * @name Micro-Kernels
+ */
+/**@{*/
+UKERNEL(add_float,   float,  ADD)
+UKERNEL(add_double,  double, ADD)
+UKERNEL(mul_float,   float,  MUL)
+UKERNEL(mul_double,  double, MUL)
+UKERNEL(fma_float,   float,  FMAF)
+UKERNEL(fma_double,  double, FMAD)
+UKERNEL(div_float,   float,  DIV)
+UKERNEL(div_double,  double, DIV)
+UKERNEL(sqrt_float,  float,  SQRTF)
+UKERNEL(sqrt_double, double, SQRTD)
+UKERNEL(cvt_float,   float,  CVTF)
+UKERNEL(cvt_double,  double, CVTD)
+/**@}*/
+
+/**
+ * @brief Micro-kernel table.
+ */
+static const struct ukernel
+{
+	const char *op;                  /**< Operation                      */
+	const char *precision;           /**< Precision                      */
+	int nops;                        /**< Instructions per Operation     */
+	double (*latency)(double);       /**< Latency Micro-Kernel           */
+	double (*throughput)(double);    /**< Throughput Micro-Kernel        */
+} ukernels[] = {
+	{ "add",  "float",  1, add_float_latency,   add_float_throughput   },
+	{ "add",  "double", 1, add_double_latency,  add_double_throughput  },
+	{ "mul",  "float",  1, mul_float_latency,   mul_float_throughput   },
+	{ "mul",  "double", 1, mul_double_latency,  mul_double_throughput  },
+	{ "fma",  "float",  1, fma_float_latency,   fma_float_throughput   },
+	{ "fma",  "double", 1, fma_double_latency,  fma_double_throughput  },
+	{ "div",  "float",  1, div_float_latency,   div_float_throughput   },
+	{ "div",  "double", 1, div_double_latency,  div_double_throughput  },
+	{ "sqrt", "float",  1, sqrt_float_latency,  sqrt_float_throughput  },
+	{ "sqrt", "double", 1, sqrt_double_latency, sqrt_double_throughput },
+	{ "cvt",  "float",  2, cvt_float_latency,   cvt_float_throughput   },
+	{ "cvt",  "double", 2, cvt_double_latency,  cvt_double_throughput  },
+};
+
+/**
+ * @brief Number of micro-kernels.
+ */
+#define NUKERNELS ((int)(sizeof(ukernels)/sizeof(ukernels[0])))
+
+/**
+ * @brief Number of operations performed by a micro-kernel.
+ */
+#define UKERNEL_NOPS(u) ((u)->nops*UKERNEL_LENGTH*UKERNEL_NACCUMULATORS)
+
+/**
+ * @brief Dump micro-kernel statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param tnum   Thread number.
+ * @param u      Target micro-kernel.
+ * @param mode   Measurement mode.
+ * @param cycles Cycles spent in the micro-kernel.
+ *
+ * @note Rates are computed without instrumentation overhead.
+ */
+static inline void ukernel_dump_stats(int it, int tnum, const struct ukernel *u, const char *mode, uint64_t cycles)
+{
+	uint64_t corrected;
+
+	corrected = perf_overhead_subtract(BENCHMARK_PERF_CYCLES, cycles);
+
+#ifdef NDEBUG
+	printf("%s %d %d %d %s %s %s %d %llu %llu %.3f %.3f\n",
+		"[benchmarks][fpu-ukernel]",
+		it,
+		NTHREADS,
+		tnum,
+		u->op,
+		u->precision,
+		mode,
+		UKERNEL_NOPS(u),
+		UINT64(cycles),
+		UINT64(corrected),
+		DOUBLE(corrected)/UKERNEL_NOPS(u),
+		UKERNEL_NOPS(u)/DOUBLE(corrected)
+	);
+#else
+	UNUSED(it);
+
+	printf("%s nthreads=%d tnum=%d    op=%-4s %-6s %-10s    cycles/op=%.3f    ops/cycle=%.3f\n",
+		"[benchmarks][fpu-ukernel]",
+		NTHREADS,
+		tnum,
+		u->op,
+		u->precision,
+		mode,
+		DOUBLE(corrected)/UKERNEL_NOPS(u),
+		UKERNEL_NOPS(u)/DOUBLE(corrected)
+	);
+#endif
+}
+
+/**
+ * @brief Runs all micro-kernels.
+ */
+static void *task_ukernels(void *arg)
+{
+	struct tdata *t = arg;
+
+	for (int k = 0; k < NUKERNELS; k++)
+	{
+		const struct ukernel *u = &ukernels[k];
+
+		for (int i = 0; i < (NITERATIONS + SKIP); i++)
+		{
+			uint64_t latency;
+			uint64_t throughput;
+
+			k1b_perf_start(0, K1B_PERF_CYCLES);
+
+				t->result = u->latency(t->tnum + 1.0);
+
+			k1b_perf_stop(0);
+
+			latency = k1b_perf_read(0);
+
+			k1b_perf_start(0, K1B_PERF_CYCLES);
+
+				t->result = u->throughput(t->tnum + 1.0);
+
+			k1b_perf_stop(0);
+
+			throughput = k1b_perf_read(0);
+
+			if (i >= SKIP)
+			{
+				ukernel_dump_stats(i - SKIP, t->tnum, u, "latency", latency);
+				ukernel_dump_stats(i - SKIP, t->tnum, u, "throughput", throughput);
+			}
+		}
+	}
+
+	return (NULL);
+}
+
+/*============================================================================*
+ * Kernel                                                                     *
+ *============================================================================*/
+
 /**
  * @brief Perform FPU operations.
  */
@@ -124,7 +364,7 @@ static void *task(void *arg)
 		{
 			k1b_perf_start(0, k1b_perf_events[j]);
 
-				t->scratch = fpu(t->scratch);
+				t->scratch = fpu(t->scratch, NFLOPS);
 
 			k1b_perf_stop(0);
 
@@ -132,37 +372,127 @@ static void *task(void *arg)
 		}
 
 		if (i >= SKIP)
-			benchmark_dump_stats(i - SKIP, FLOPS, stats);
+		{
+			benchmark_dump_stats(i - SKIP, NFLOPS, stats);
+			scaling_sample(t->tnum, i - SKIP, stats[BENCHMARK_PERF_CYCLES]);
+		}
 	}
 
 	return (NULL);
 }
 
+#ifdef OPENMP
+
+/**
+ * @brief Runs a pass of the pthread variant of the kernel.
+ */
+static void *task_pass(void *arg)
+{
+	struct tdata *t = arg;
+
+	t->scratch = fpu(t->scratch, NFLOPS);
+
+	return (NULL);
+}
+
+/**
+ * @brief Compares the FPU Kernel against its OpenMP Variant
+ *
+ * @param nthreads Number of working threads.
+ */
+static void kernel_fpu_openmp(int nthreads)
+{
+	uint64_t best[OPENMP_NVARIANTS] = { UINT64_MAX, UINT64_MAX };
+
+	openmp_bind(nthreads);
+
+	for (int it = 0; it < (NITERATIONS + SKIP); it++)
+	{
+		for (int pass = 0; pass < OPENMP_NVARIANTS; pass++)
+		{
+			int variant = OPENMP_VARIANT(it, pass);
+			pthread_t tid[NTHREADS_MAX];
+			uint64_t start;
+			uint64_t end;
+
+			start = k1b_perf_timestamp();
+
+			if (variant == OPENMP_PTHREADS)
+			{
+				for (int i = 0; i < nthreads; i++)
+					affinity_thread_create(&tid[i], i, task_pass, PERTHREAD_GET(tdata, i));
+				for (int i = 0; i < nthreads; i++)
+					pthread_join(tid[i], NULL);
+			}
+			else
+			{
+				#pragma omp parallel for num_threads(nthreads) schedule(static)
+				for (int i = 0; i < nthreads; i++)
+					PERTHREAD_GET(tdata, i)->scratch = fpu(PERTHREAD_GET(tdata, i)->scratch, NFLOPS);
+			}
+
+			end = k1b_perf_timestamp();
+
+			if ((it >= SKIP) && (end - start < best[variant]))
+				best[variant] = end - start;
+		}
+	}
+
+	openmp_dump("[benchmarks][fpu]", nthreads, best[OPENMP_PTHREADS], best[OPENMP_OPENMP]);
+}
+
+#endif
+
 /**
  * @brief FPU Benchmark Kernel
  *
  * @param nthreads Number of working threads.
+ * @param fn       Thread function.
  */
-static void kernel_fpu(int nthreads)
+static void kernel_fpu(int nthreads, void *(*fn)(void *))
 {
 	pthread_t tid[NTHREADS_MAX];
 
 	/* Save kernel parameters. */
 	NTHREADS = nthreads;
+#ifdef WEAK_SCALING
+	NFLOPS = FLOPS;
+#else
+	/*
+	 * Work of NTHREADS_MAX threads is split among working threads, in
+	 * whole iterations of fpu(), so that reported work is carried out.
+	 */
+	NFLOPS = (((FLOPS*NTHREADS_MAX)/nthreads)/FLOPS_STEP)*FLOPS_STEP;
+#endif
 
 	/* Spawn threads. */
 	for (int i = 0; i < nthreads; i++)
 	{
 		/* Initialize thread data structure. */
-		tdata[i].scratch = 0.0;
-		tdata[i].tnum = i;
+		PERTHREAD_GET(tdata, i)->scratch = 0.0;
+		PERTHREAD_GET(tdata, i)->tnum = i;
 
-		pthread_create(&tid[i], NULL, task, &tdata[i]);
+		affinity_thread_create(&tid[i], i, fn, PERTHREAD_GET(tdata, i));
 	}
 
 	/* Wait for threads. */
 	for (int i = 0; i < nthreads; i++)
 		pthread_join(tid[i], NULL);
+
+	/* Micro-kernels record no samples. Operands live in registers. */
+	roofline_dump("[benchmarks][fpu]",
+		nthreads,
+		DOUBLE(NFLOPS)*nthreads,
+		0.0,
+		scaling_record(nthreads)
+	);
+	affinity_dump("[benchmarks][fpu]", nthreads);
+	footprint_dump("[benchmarks][fpu]", nthreads);
+
+#ifdef OPENMP
+	if (fn == task)
+		kernel_fpu_openmp(nthreads);
+#endif
 }
 
 /**
@@ -173,15 +503,23 @@ int main(int argc, char **argv)
 	((void) argc);
 	((void) argv);
 
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][fpu]");
 
 #ifndef NDEBUG
 
-	kernel_fpu(NTHREADS_MAX);
+	kernel_fpu(NTHREADS_MAX, task);
+	kernel_fpu(NTHREADS_MAX, task_ukernels);
 
 #else
 
 	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
-		kernel_fpu(nthreads);
+		kernel_fpu(nthreads, task);
+
+	scaling_dump("[benchmarks][fpu]");
+
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+		kernel_fpu(nthreads, task_ukernels);
 
 #endif
 
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef __k1__
+#include <mppa/osconfig.h>
+#endif
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN               1  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX  (NUM_CORES - 1) /**< Maximum Number of Working Threads      */
+#define NTHREADS_STEP              1  /**< Increment on Number of Working Threads */
+#define NOPS                   16384  /**< Increments per Thread                  */
+/**@}*/
+
+/**
+ * @name Layouts of Per-Thread Counters
+ */
+/**@{*/
+#define LAYOUT_PACKED 0 /**< Adjacent Counters              */
+#define LAYOUT_PADDED 1 /**< Counters in Lines of Their Own */
+#define NLAYOUTS      2 /**< Number of Layouts              */
+/**@}*/
+
+/**
+ * @brief Names of layouts.
+ */
+static const char *layouts[NLAYOUTS] = { "packed", "padded" };
+
+/**
+ * @brief Task info.
+ */
+struct tdata
+{
+	int tnum; /**< Thread Number */
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS_MAX);
+
+/**
+ * @name Per-Thread Counters
+ */
+/**@{*/
+static int packed[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE); /**< Packed Counters */
+static PERTHREAD(int, padded, NTHREADS_MAX);             /**< Padded Counters */
+/**@}*/
+
+/**
+ * @brief Barrier of working threads.
+ */
+static pthread_barrier_t barrier;
+
+/**
+ * @name Benchmark Kernel Parameters
+ */
+/**@{*/
+static int NTHREADS; /**< Number of Working Threads */
+/**@}*/
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param tnum   Thread number.
+ * @param layout Layout of counters.
+ * @param stats  Execution statistics.
+ */
+static inline void benchmark_dump_stats(int it, int tnum, int layout, uint64_t *stats)
+{
+	uint64_t corrected[BENCHMARK_PERF_EVENTS];
+
+	perf_stats_check("[benchmarks][false-sharing]", it, NTHREADS, stats);
+	perf_overhead_correct(corrected, stats);
+
+#ifdef NDEBUG
+	char buf_raw[PERF_STATS_STRLEN];
+	char buf_corrected[PERF_STATS_STRLEN];
+
+	perf_stats_format(buf_raw, sizeof(buf_raw), stats);
+	perf_stats_format(buf_corrected, sizeof(buf_corrected), corrected);
+
+	printf("%s %d %d %d %s %d %s %s\n",
+		"[benchmarks][false-sharing]",
+		it,
+		NTHREADS,
+		tnum,
+		layouts[layout],
+		NOPS,
+		buf_raw,
+		buf_corrected
+	);
+#else
+	UNUSED(it);
+
+	printf("%s nthreads=%d tnum=%d    layout=%s    cycles/op=%.3f    dcache misses/op=%.3f\n",
+		"[benchmarks][false-sharing]",
+		NTHREADS,
+		tnum,
+		layouts[layout],
+		DOUBLE(corrected[BENCHMARK_PERF_CYCLES])/NOPS,
+		DOUBLE(corrected[BENCHMARK_PERF_DCACHE_MISSES])/NOPS
+	);
+#endif
+
+	perf_metrics_dump("[benchmarks][false-sharing]", it, NTHREADS, corrected);
+}
+
+/**
+ * @brief Increments a counter.
+ *
+ * @param counter Target counter.
+ */
+static void increment(volatile int *counter)
+{
+	for (int i = 0; i < NOPS; i++)
+		(*counter)++;
+}
+
+/**
+ * @brief Increments the counter of a thread in all layouts.
+ */
+static void *task(void *arg)
+{
+	struct tdata *t = arg;
+	volatile int *counters[NLAYOUTS];
+	uint64_t stats[BENCHMARK_PERF_EVENTS];
+
+	counters[LAYOUT_PACKED] = &packed[t->tnum];
+	counters[LAYOUT_PADDED] = PERTHREAD_GET(padded, t->tnum);
+
+	for (int layout = 0; layout < NLAYOUTS; layout++)
+	{
+		for (int i = 0; i < (NITERATIONS + SKIP); i++)
+		{
+			for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+			{
+				/* Contend with all threads. */
+				pthread_barrier_wait(&barrier);
+
+				k1b_perf_start(0, k1b_perf_events[j]);
+
+					increment(counters[layout]);
+
+				k1b_perf_stop(0);
+
+				stats[j] = k1b_perf_read(0);
+			}
+
+			if (i >= SKIP)
+				benchmark_dump_stats(i - SKIP, t->tnum, layout, stats);
+		}
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief False Sharing Benchmark Kernel
+ *
+ * @param nthreads Number of working threads.
+ */
+static void kernel_false_sharing(int nthreads)
+{
+	pthread_t tid[NTHREADS_MAX];
+
+	/* Save kernel parameters. */
+	NTHREADS = nthreads;
+
+	pthread_barrier_init(&barrier, NULL, nthreads);
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		/* Initialize thread data structure. */
+		PERTHREAD_GET(tdata, i)->tnum = i;
+
+		affinity_thread_create(&tid[i], i, task, PERTHREAD_GET(tdata, i));
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		pthread_join(tid[i], NULL);
+
+	pthread_barrier_destroy(&barrier);
+
+	affinity_dump("[benchmarks][false-sharing]", nthreads);
+	footprint_dump("[benchmarks][false-sharing]", nthreads);
+}
+
+/**
+ * @brief False Sharing Benchmark
+ */
+int main(int argc, char **argv)
+{
+	((void) argc);
+	((void) argv);
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][false-sharing]");
+
+#ifndef NDEBUG
+
+	kernel_false_sharing(NTHREADS_MAX);
+
+#else
+
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+		kernel_false_sharing(nthreads);
+
+#endif
+
+	return (0);
+}
@@ -15,7 +15,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef __k1__
 #include <mppa/osconfig.h>
+#endif
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -31,6 +33,15 @@
 #define NTHREADS_STEP                     1  /**< Increment on Number of Working Threads */
 #define MASKSIZE                          7  /**< Mask Size                              */
 #define IMGSIZE       (770 + (MASKSIZE - 1)) /**< Image Size                             */
+#define BATCHSIZE                        64  /**< Random Numbers Generated per Batch     */
+/**@}*/
+
+/**
+ * @name Profiling Regions
+ */
+/**@{*/
+#define REGION_MASK   0 /**< Mask Generation */
+#define REGION_FILTER 1 /**< Filtering       */
 /**@}*/
 
 /**
@@ -38,6 +49,7 @@
  */
 /**@{*/
 static int NTHREADS; /**< Number of Working Threads */
+static int NROWS;    /**< Number of Lines Filtered  */
 /**@}*/
 
 /**
@@ -48,22 +60,27 @@ struct tdata
 	int tnum; /**< Thread Number */
 	int i0;   /**< Start Line    */
 	int in;   /**< End Line      */
-} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS_MAX);
 
 /**
  * @brief Mask.
  */
-static double mask[MASKSIZE*MASKSIZE] ALIGN(CACHE_LINE_SIZE);
+static double *mask;
 
 /**
  * @brief Image.
  */
-static unsigned char img[IMGSIZE*IMGSIZE] ALIGN(CACHE_LINE_SIZE);
+static unsigned char *img;
 
 /**
  * @brief Output image.
  */
-static unsigned char output[IMGSIZE*IMGSIZE] ALIGN(CACHE_LINE_SIZE);
+static unsigned char *output;
 
 /**
  * @brief Indexes the mask.
@@ -90,40 +107,42 @@ static unsigned char output[IMGSIZE*IMGSIZE] ALIGN(CACHE_LINE_SIZE);
  */
 static inline void benchmark_dump_stats(int it, int imgsize, int masksize, uint64_t *stats)
 {
+	uint64_t corrected[BENCHMARK_PERF_EVENTS];
+
+	perf_stats_check("[benchmarks][gauss-filter]", it, NTHREADS, stats);
+	perf_overhead_correct(corrected, stats);
+
 #ifdef NDEBUG
-	printf("%s %d %d %d %d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+	char buf_raw[PERF_STATS_STRLEN];
+	char buf_corrected[PERF_STATS_STRLEN];
+
+	perf_stats_format(buf_raw, sizeof(buf_raw), stats);
+	perf_stats_format(buf_corrected, sizeof(buf_corrected), corrected);
+
+	printf("%s %d %d %d %d %s %s\n",
 		"[benchmarks][gauss-filter]",
 		it,
 		NTHREADS,
 		imgsize,
 		masksize,
-		UINT32(stats[0]),
-		UINT32(stats[1]),
-		UINT32(stats[2]),
-		UINT32(stats[3]),
-		UINT32(stats[4]),
-		UINT32(stats[5]),
-		UINT32(stats[6]),
-		UINT32(stats[7]),
-		UINT32(stats[8]),
-		UINT32(stats[9]),
-		UINT32(stats[10]),
-		UINT32(stats[11]),
-		UINT32(stats[12]),
-		UINT32(stats[13])
+		buf_raw,
+		buf_corrected
 	);
 #else
 	UNUSED(it);
 
-	printf("%s nthreads=%d imgsize=%d    masksize=%d    time=%.2f s    flops=%.2f Mflops\n",
+	printf("%s nthreads=%d imgsize=%d    masksize=%d    time=%.6f s (%.6f s corrected)    flops=%.2f Mflops\n",
 		"[benchmarks][gauss-filter]",
 		NTHREADS,
 		imgsize,
 		masksize,
-		(UINT32(stats[0])/FLOAT(CLUSTER_FREQ)),
-		(FLOAT(2*MASKSIZE*MASKSIZE*IMGSIZE*IMGSIZE)/NTHREADS)/(UINT32(stats[0])/FLOAT(CLUSTER_FREQ))
+		CYCLES_TO_SECONDS(stats[0]),
+		CYCLES_TO_SECONDS(corrected[0]),
+		(2*DOUBLE(MASKSIZE)*MASKSIZE*NROWS*IMGSIZE/NTHREADS)/CYCLES_TO_USECONDS(corrected[0])
 	);
 #endif
+
+	perf_metrics_dump("[benchmarks][gauss-filter]", it, NTHREADS, corrected);
 }
 
 /**
@@ -142,7 +161,7 @@ static inline void generate_mask(void)
 			double sec;
 
 			sec = -((i*i + j*j)/2.0*SD*SD);
-			sec = powerd(E, sec);
+			sec = exponential(sec);
 
 			MASK(i + half, j + half) = first*sec;
 			total += MASK(i + half, j + half);
@@ -156,6 +175,39 @@ static inline void generate_mask(void)
 	}
 }
 
+/**
+ * @brief Generates a chunk of the image.
+ *
+ * Each line is drawn from a stream of its own, so the image does not
+ * depend on how lines are split among threads.
+ *
+ * @param i0 Start line.
+ * @param in End line.
+ */
+static inline void generate_image(int i0, int in)
+{
+	struct rng_stream stream;
+	unsigned buf[BATCHSIZE];
+
+	rng_stream_initialize(&stream, SEED, i0);
+
+	for (int i = i0; i < in; i++, rng_stream_jump(&stream))
+	{
+		struct rng_stream line = stream;
+
+		for (int j = 0; j < IMGSIZE; j += BATCHSIZE)
+		{
+			int n = ((IMGSIZE - j) < BATCHSIZE) ?
+				(IMGSIZE - j) : BATCHSIZE;
+
+			rng_stream_fill(&line, buf, n);
+
+			for (int k = 0; k < n; k++)
+				img[i*IMGSIZE + j + k] = buf[k] & 0xff;
+		}
+	}
+}
+
 /**
  * @brief Applies a gaussian filter to an image.
  *
@@ -200,13 +252,20 @@ static void *task(void *arg)
 
 	stats[0] = UINT64_MAX;
 
+	/* Each thread generates the lines that it filters. */
+	generate_image(i0, in);
+
+	K1B_PERF_REGION_SETUP(K1B_PERF_CYCLES);
+
 	for (int i = 0; i < (NITERATIONS + SKIP); i++)
 	{
 		for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
 		{
 			k1b_perf_start(0, k1b_perf_events[j]);
 
+				K1B_PERF_REGION_BEGIN(REGION_FILTER);
 				gauss_filter(i0, in);
+				K1B_PERF_REGION_END(REGION_FILTER);
 
 			k1b_perf_stop(0);
 
@@ -214,12 +273,81 @@ static void *task(void *arg)
 		}
 
 		if (i >= SKIP)
+		{
 			benchmark_dump_stats(i - SKIP, IMGSIZE, MASKSIZE, stats);
+			scaling_sample(t->tnum, i - SKIP, stats[BENCHMARK_PERF_CYCLES]);
+		}
 	}
 
 	return (NULL);
 }
 
+#ifdef OPENMP
+
+/**
+ * @brief Runs a pass of the pthread variant of the kernel.
+ */
+static void *task_pass(void *arg)
+{
+	struct tdata *t = arg;
+
+	gauss_filter(t->i0, t->in);
+
+	return (NULL);
+}
+
+/**
+ * @brief Compares the Gaussian Filter Kernel against its OpenMP Variant
+ *
+ * Chunks of lines are those of working threads, so that both
+ * variants skip the same halo lines.
+ *
+ * @param nthreads Number of working threads.
+ * @param nrows    Lines per chunk.
+ */
+static void kernel_gauss_filter_openmp(int nthreads, int nrows)
+{
+	uint64_t best[OPENMP_NVARIANTS] = { UINT64_MAX, UINT64_MAX };
+
+	openmp_bind(nthreads);
+
+	for (int it = 0; it < (NITERATIONS + SKIP); it++)
+	{
+		for (int pass = 0; pass < OPENMP_NVARIANTS; pass++)
+		{
+			int variant = OPENMP_VARIANT(it, pass);
+			pthread_t tid[NTHREADS_MAX];
+			uint64_t start;
+			uint64_t end;
+
+			start = k1b_perf_timestamp();
+
+			if (variant == OPENMP_PTHREADS)
+			{
+				for (int i = 0; i < nthreads; i++)
+					affinity_thread_create(&tid[i], i, task_pass, PERTHREAD_GET(tdata, i));
+				for (int i = 0; i < nthreads; i++)
+					pthread_join(tid[i], NULL);
+			}
+			else
+			{
+				#pragma omp parallel for num_threads(nthreads) schedule(static)
+				for (int i = 0; i < nthreads; i++)
+					gauss_filter(nrows*i, (i == (nthreads - 1)) ? NROWS : (i + 1)*nrows);
+			}
+
+			end = k1b_perf_timestamp();
+
+			if ((it >= SKIP) && (end - start < best[variant]))
+				best[variant] = end - start;
+		}
+	}
+
+	openmp_dump("[benchmarks][gauss-filter]", nthreads, best[OPENMP_PTHREADS], best[OPENMP_OPENMP]);
+}
+
+#endif
+
 /**
  * @brief Guassian Filter Benchmark Kernel
  *
@@ -233,24 +361,65 @@ static void kernel_gauss_filter(int nthreads)
 	/* Save kernel parameters. */
 	NTHREADS = nthreads;
 
+	arena_reset();
+	mask = arena_alloc(MASKSIZE*MASKSIZE*sizeof(double));
+	img = arena_alloc(IMGSIZE*IMGSIZE*sizeof(unsigned char));
+	output = arena_alloc(IMGSIZE*IMGSIZE*sizeof(unsigned char));
+
+	if (output == NULL)
+	{
+		arena_dump("[benchmarks][gauss-filter]");
+		return;
+	}
+
+	K1B_PERF_REGION_NAME(REGION_MASK, "mask");
+	K1B_PERF_REGION_NAME(REGION_FILTER, "filter");
+	K1B_PERF_REGION_SETUP(K1B_PERF_CYCLES);
+
 	/* Generate mask. */
+	K1B_PERF_REGION_BEGIN(REGION_MASK);
 	generate_mask();
+	K1B_PERF_REGION_END(REGION_MASK);
 
-	/* Spawn threads. */
+#ifdef WEAK_SCALING
+	/* Lines per thread are fixed, thus the image grows with threads. */
+	nrows = IMGSIZE/NTHREADS_MAX;
+	NROWS = nrows*nthreads;
+#else
 	nrows = IMGSIZE/nthreads;
+	NROWS = IMGSIZE;
+#endif
+
+	/* Spawn threads. */
 	for (int i = 0; i < nthreads; i++)
 	{
 		/* Initialize thread data structure. */
-		tdata[i].i0 = nrows*i;
-		tdata[i].in = (i == (nthreads - 1)) ? IMGSIZE : (i + 1)*nrows;
-		tdata[i].tnum = i;
+		PERTHREAD_GET(tdata, i)->i0 = nrows*i;
+		PERTHREAD_GET(tdata, i)->in = (i == (nthreads - 1)) ? NROWS : (i + 1)*nrows;
+		PERTHREAD_GET(tdata, i)->tnum = i;
 
-		pthread_create(&tid[i], NULL, task, &tdata[i]);
+		affinity_thread_create(&tid[i], i, task, PERTHREAD_GET(tdata, i));
 	}
 
 	/* Wait for threads. */
 	for (int i = 0; i < nthreads; i++)
 		pthread_join(tid[i], NULL);
+
+	/* Rows of img and output, and the mask, are moved once. */
+	roofline_dump("[benchmarks][gauss-filter]",
+		nthreads,
+		2*DOUBLE(MASKSIZE)*MASKSIZE*NROWS*IMGSIZE,
+		2*DOUBLE(NROWS)*IMGSIZE*sizeof(unsigned char) + DOUBLE(MASKSIZE)*MASKSIZE*sizeof(double),
+		scaling_record(nthreads)
+	);
+	affinity_dump("[benchmarks][gauss-filter]", nthreads);
+	footprint_dump("[benchmarks][gauss-filter]", nthreads);
+
+	PERF_REGIONS_DUMP("[benchmarks][gauss-filter]", 0, nthreads);
+
+#ifdef OPENMP
+	kernel_gauss_filter_openmp(nthreads, nrows);
+#endif
 }
 
 /**
@@ -261,6 +430,9 @@ int main(int argc, char **argv)
 	((void) argc);
 	((void) argv);
 
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][gauss-filter]");
+
 #ifndef NDEBUG
 
 	kernel_gauss_filter(NTHREADS_MAX);
@@ -270,6 +442,8 @@ int main(int argc, char **argv)
 	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
 		kernel_gauss_filter(nthreads);
 
+	scaling_dump("[benchmarks][gauss-filter]");
+
 #endif
 
 	return (0);
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef __k1__
+#include <mppa/osconfig.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NLOADS            8192  /**< Loads per Traversal                          */
+#define UNROLL              16  /**< Loads per Loop Iteration                     */
+#define STRIDE_MIN          16  /**< Minimum Distance between Nodes (in bytes)    */
+#define STRIDE_MAX        4096  /**< Maximum Distance between Nodes (in bytes)    */
+#define WSET_MIN          1024  /**< Minimum Working Set (in bytes)               */
+#define CLIFF_THRESHOLD   1.5L  /**< Latency Increase that Marks a Cliff          */
+/**@}*/
+
+/**
+ * @name Maximum Working Set (in bytes)
+ *
+ * The largest working set takes most of the memory that is left to
+ * static data of the cluster. Static data of the IO cluster is placed
+ * in DDR.
+ */
+/**@{*/
+#if defined(__node__)
+	#define WSET_MAX (1024*1024)
+	#define MEMORY "smem"
+#elif defined(__k1__)
+	#define WSET_MAX (16*1024*1024)
+	#define MEMORY "ddr"
+#else
+	#define WSET_MAX (64*1024*1024)
+	#define MEMORY "host"
+#endif
+/**@}*/
+
+/**
+ * @brief Number of working sets.
+ */
+#define NWSETS 32
+
+/**
+ * @name Indexes of Measured Events
+ */
+/**@{*/
+#define EVENT_CYCLES        0 /**< Cycles              */
+#define EVENT_DCACHE_MISSES 1 /**< Data Cache Misses   */
+#define EVENT_DTLB_STALLS   2 /**< Data TLB Stalls     */
+#define NEVENTS             3 /**< Number of Events    */
+/**@}*/
+
+/**
+ * @brief Measured events, as indexes in k1b_perf_events[].
+ */
+static const int events[NEVENTS] = {
+	BENCHMARK_PERF_CYCLES,
+	BENCHMARK_PERF_DCACHE_MISSES,
+	BENCHMARK_PERF_DTLB_STALLS
+};
+
+/**
+ * @brief Memory where pointer chains are built.
+ */
+static char *chain;
+
+/**
+ * @brief Best latency on each working set at the cache line stride
+ * (in cycles per load).
+ */
+static double latency[NWSETS];
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param wset   Working set (in bytes).
+ * @param stride Distance between nodes (in bytes).
+ * @param stats  Measured events, without instrumentation overhead.
+ */
+static inline void benchmark_dump_stats(int it, int wset, int stride, const uint64_t *stats)
+{
+	double cpl;
+
+	cpl = DOUBLE(stats[EVENT_CYCLES])/NLOADS;
+
+#ifdef NDEBUG
+	printf("%s %d %s %d %d %d %llu %llu %llu %.3f %.3f\n",
+		"[benchmarks][latency]",
+		it,
+		MEMORY,
+		wset,
+		stride,
+		NLOADS,
+		UINT64(stats[EVENT_CYCLES]),
+		UINT64(stats[EVENT_DCACHE_MISSES]),
+		UINT64(stats[EVENT_DTLB_STALLS]),
+		cpl,
+		CYCLES_TO_USECONDS(cpl)*1000
+	);
+#else
+	UNUSED(it);
+
+	printf("%s memory=%s    wset=%d B    stride=%d B    latency=%.3f ns/load    dtlb stalls/load=%.3f\n",
+		"[benchmarks][latency]",
+		MEMORY,
+		wset,
+		stride,
+		CYCLES_TO_USECONDS(cpl)*1000,
+		DOUBLE(stats[EVENT_DTLB_STALLS])/NLOADS
+	);
+#endif
+}
+
+/**
+ * @brief Returns a node of a pointer chain.
+ *
+ * @param i      Node number.
+ * @param stride Distance between nodes (in bytes).
+ */
+static inline void **node(int i, int stride)
+{
+	return ((void **) &chain[i*stride]);
+}
+
+/**
+ * @brief Builds a pointer chain.
+ *
+ * Nodes are placed @p stride bytes apart and linked in a random
+ * cyclic order (Sattolo's algorithm), so that every node is visited
+ * once per cycle and hardware prefetching cannot guess the next one.
+ *
+ * @param state  Pseudo-random number generator.
+ * @param wset   Working set (in bytes).
+ * @param stride Distance between nodes (in bytes).
+ *
+ * @returns The first node of the chain.
+ */
+static void **chain_build(struct rng_state *state, int wset, int stride)
+{
+	int nnodes = wset/stride;
+
+	for (int i = 0; i < nnodes; i++)
+		*node(i, stride) = node(i, stride);
+
+	for (int i = nnodes - 1; i > 0; i--)
+	{
+		int j = rng_next(state)%i;
+		void *tmp = *node(i, stride);
+
+		*node(i, stride) = *node(j, stride);
+		*node(j, stride) = tmp;
+	}
+
+	return (node(0, stride));
+}
+
+/**
+ * @brief Follows a pointer chain.
+ *
+ * @param p      Start node.
+ * @param nloads Number of loads, multiple of UNROLL.
+ *
+ * @returns The node reached.
+ */
+static void **chain_chase(void **p, int nloads)
+{
+	#define LOAD p = (void **) *p;
+
+	for (int i = 0; i < nloads; i += UNROLL)
+	{
+		LOAD LOAD LOAD LOAD LOAD LOAD LOAD LOAD
+		LOAD LOAD LOAD LOAD LOAD LOAD LOAD LOAD
+	}
+
+	#undef LOAD
+
+	return (p);
+}
+
+/**
+ * @brief Memory Latency Benchmark Kernel
+ *
+ * @param state  Pseudo-random number generator.
+ * @param wset   Working set (in bytes).
+ * @param stride Distance between nodes (in bytes).
+ *
+ * @returns The best latency (in cycles per load).
+ */
+static double kernel_latency(struct rng_state *state, int wset, int stride)
+{
+	void **volatile sink;
+	void **p;
+	uint64_t best = 0;
+
+	p = chain_build(state, wset, stride);
+
+	/* Warm up caches and TLB. */
+	p = chain_chase(p, NLOADS);
+
+	for (int i = 0; i < (NITERATIONS + SKIP); i++)
+	{
+		uint64_t stats[NEVENTS];
+
+		for (int j = 0; j < NEVENTS; j++)
+		{
+			k1b_perf_start(0, k1b_perf_events[events[j]]);
+
+				p = chain_chase(p, NLOADS);
+
+			k1b_perf_stop(0);
+
+			stats[j] = perf_overhead_subtract(events[j], k1b_perf_read(0));
+		}
+
+		if (i >= SKIP)
+		{
+			if ((i == SKIP) || (stats[EVENT_CYCLES] < best))
+				best = stats[EVENT_CYCLES];
+
+			benchmark_dump_stats(i - SKIP, wset, stride, stats);
+		}
+	}
+
+	/* Keep the chase alive. */
+	sink = p;
+	UNUSED(sink);
+
+	return (DOUBLE(best)/NLOADS);
+}
+
+/**
+ * @brief Dumps the cache size derived from latency cliffs.
+ *
+ * The cache size is the largest working set, at the cache line stride,
+ * whose latency is below CLIFF_THRESHOLD times the latency of the
+ * smallest working set.
+ */
+static void benchmark_dump_derived(void)
+{
+	int size = 0;
+	int i = 0;
+
+	for (int wset = WSET_MIN; wset <= WSET_MAX; wset *= 2, i++)
+	{
+		if (latency[i] > CLIFF_THRESHOLD*latency[0])
+			break;
+
+		size = wset;
+	}
+
+#ifdef NDEBUG
+	printf("%s %s %d %d\n",
+		"[benchmarks][latency][derived]",
+		MEMORY,
+		size,
+		CACHE_SIZE
+	);
+#else
+	printf("%s memory=%s    cache size=%d B    (constant %d B)\n",
+		"[benchmarks][latency][derived]",
+		MEMORY,
+		size,
+		CACHE_SIZE
+	);
+#endif
+}
+
+/**
+ * @brief Memory Latency Benchmark
+ */
+int main(int argc, char **argv)
+{
+	struct rng_state state;
+
+	((void) argc);
+	((void) argv);
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][latency]");
+
+	arena_reset();
+	if ((chain = arena_alloc(WSET_MAX)) == NULL)
+	{
+		arena_dump("[benchmarks][latency]");
+		return (-1);
+	}
+
+	rng_initialize(&state);
+
+	for (int stride = STRIDE_MIN; stride <= STRIDE_MAX; stride *= 2)
+	{
+		int i = 0;
+
+		/* Chains need at least two nodes. */
+		for (int wset = WSET_MIN; wset <= WSET_MAX; wset *= 2, i++)
+		{
+			double best;
+
+			if (wset < 2*stride)
+				continue;
+
+			best = kernel_latency(&state, wset, stride);
+
+			if (stride == CACHE_LINE_SIZE)
+				latency[i] = best;
+		}
+	}
+
+	benchmark_dump_derived();
+	footprint_dump("[benchmarks][latency]", 0);
+
+	return (0);
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef __k1__
+#include <mppa/osconfig.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NSAMPLES 256 /**< Number of Input Samples */
+/**@}*/
+
+/**
+ * @name Input Ranges
+ */
+/**@{*/
+#define SQRT_MAX  20000 /**< Maximum Input for Square Root (Squared Distances in TSP) */
+#define EXP_MIN     -16 /**< Minimum Input for Exponentiation (Exponents in GF)       */
+#define POW_MAX      16 /**< Maximum Absolute Exponent for Power                      */
+/**@}*/
+
+/**
+ * @brief Input samples.
+ */
+/**@{*/
+static double *inputs;
+static int *exponents;
+/**@}*/
+
+/**
+ * @brief Results.
+ */
+static double *results;
+
+/*============================================================================*
+ * Legacy Routines                                                            *
+ *============================================================================*/
+
+/**
+ * @brief Computes n^0.5 with an unbounded Newton loop.
+ */
+static double legacy_squared(double n)
+{
+	double s;
+
+	if (n <= 0)
+		return (0);
+
+	s = n;
+
+	while ((s - n/s) > 0.001)
+		s = (s + n/s)/2;
+
+	return (s);
+}
+
+/**
+ * @brief Computes x^y recursively.
+ */
+static double legacy_powerd(double x, int y)
+{
+	double temp;
+
+	if (y == 0)
+		return 1;
+
+	temp = legacy_powerd(x, y/2);
+
+	if ((y % 2) == 0)
+		return (temp*temp);
+
+	if (y > 0)
+		return (x*temp*temp);
+
+	return (temp*temp)/x;
+}
+
+/**
+ * @brief Computes e^x as in the legacy generate_mask().
+ */
+static double legacy_exponential(double x)
+{
+	return (legacy_powerd(E, x));
+}
+
+/*============================================================================*
+ * Reference Routines                                                         *
+ *============================================================================*/
+
+/**
+ * @brief Computes n^0.5 with the math library.
+ */
+static double reference_squared(double n)
+{
+	return (__builtin_sqrt(n));
+}
+
+/**
+ * @brief Computes x^y with the math library.
+ */
+static double reference_powerd(double x, int y)
+{
+	return (__builtin_pow(x, y));
+}
+
+/**
+ * @brief Computes e^x with the math library.
+ */
+static double reference_exponential(double x)
+{
+	return (__builtin_exp(x));
+}
+
+/**
+ * @brief Computes x^y with the fast routine.
+ */
+static double fast_powerd(double x, int y)
+{
+	return (powerd(x, y));
+}
+
+/*============================================================================*
+ * Benchmark                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Absolute value.
+ */
+#define ABS(x) (((x) < 0) ? -(x) : (x))
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param fn     Name of the function.
+ * @param impl   Name of the implementation.
+ * @param cycles Cycles spent in the function.
+ * @param error  Maximum relative error.
+ */
+static inline void benchmark_dump_stats(int it, const char *fn, const char *impl, uint64_t cycles, double error)
+{
+	uint64_t corrected;
+
+	corrected = perf_overhead_subtract(BENCHMARK_PERF_CYCLES, cycles);
+
+#ifdef NDEBUG
+	printf("%s %d %s %s %d %llu %llu %e\n",
+		"[benchmarks][math]",
+		it,
+		fn,
+		impl,
+		NSAMPLES,
+		UINT64(cycles),
+		UINT64(corrected),
+		error
+	);
+#else
+	UNUSED(it);
+
+	printf("%s function=%-5s impl=%-6s    cycles/call=%.2f    max error=%e\n",
+		"[benchmarks][math]",
+		fn,
+		impl,
+		DOUBLE(corrected)/NSAMPLES,
+		error
+	);
+#endif
+}
+
+/**
+ * @brief Computes the maximum relative error of the results.
+ *
+ * @param ref Reference function.
+ */
+static double max_error(double (*ref)(double))
+{
+	double error = 0.0;
+
+	for (int i = 0; i < NSAMPLES; i++)
+	{
+		double r = ref(inputs[i]);
+		double e = (r > 0) ? ABS(results[i] - r)/r : ABS(results[i] - r);
+
+		if (e > error)
+			error = e;
+	}
+
+	return (error);
+}
+
+/**
+ * @brief Computes the maximum relative error of the results of a power.
+ */
+static double max_error_powerd(void)
+{
+	double error = 0.0;
+
+	for (int i = 0; i < NSAMPLES; i++)
+	{
+		double r = reference_powerd(inputs[i], exponents[i]);
+		double e = ABS(results[i] - r)/r;
+
+		if (e > error)
+			error = e;
+	}
+
+	return (error);
+}
+
+/**
+ * @brief Benchmarks a unary math function.
+ *
+ * @param name Name of the function.
+ * @param impl Name of the implementation.
+ * @param fn   Function.
+ * @param ref  Reference function.
+ */
+static void benchmark(const char *name, const char *impl, double (*fn)(double), double (*ref)(double))
+{
+	for (int i = 0; i < (NITERATIONS + SKIP); i++)
+	{
+		uint64_t cycles;
+
+		k1b_perf_start(0, K1B_PERF_CYCLES);
+
+			for (int j = 0; j < NSAMPLES; j++)
+				results[j] = fn(inputs[j]);
+
+		k1b_perf_stop(0);
+
+		cycles = k1b_perf_read(0);
+
+		if (i >= SKIP)
+			benchmark_dump_stats(i - SKIP, name, impl, cycles, max_error(ref));
+	}
+}
+
+/**
+ * @brief Benchmarks a power function.
+ *
+ * @param impl Name of the implementation.
+ * @param fn   Function.
+ */
+static void benchmark_powerd(const char *impl, double (*fn)(double, int))
+{
+	for (int i = 0; i < (NITERATIONS + SKIP); i++)
+	{
+		uint64_t cycles;
+
+		k1b_perf_start(0, K1B_PERF_CYCLES);
+
+			for (int j = 0; j < NSAMPLES; j++)
+				results[j] = fn(inputs[j], exponents[j]);
+
+		k1b_perf_stop(0);
+
+		cycles = k1b_perf_read(0);
+
+		if (i >= SKIP)
+			benchmark_dump_stats(i - SKIP, "pow", impl, cycles, max_error_powerd());
+	}
+}
+
+/**
+ * @brief Math Library Benchmark Kernel
+ */
+static void kernel_math(void)
+{
+	struct rng_state rand_state;
+
+	arena_reset();
+	inputs = arena_alloc(NSAMPLES*sizeof(double));
+	exponents = arena_alloc(NSAMPLES*sizeof(int));
+	results = arena_alloc(NSAMPLES*sizeof(double));
+
+	if (results == NULL)
+	{
+		arena_dump("[benchmarks][math]");
+		return;
+	}
+
+	rng_initialize(&rand_state);
+
+	/* Square root. */
+	for (int i = 0; i < NSAMPLES; i++)
+		inputs[i] = rng_next(&rand_state) % SQRT_MAX;
+	benchmark("sqrt", "legacy", legacy_squared, reference_squared);
+	benchmark("sqrt", "fast", squared, reference_squared);
+
+	/*
+	 * Exponentiation. The legacy routine truncates the power to an
+	 * integer, thus both routines are compared on integer powers
+	 * (expi), and the fast one is then benchmarked alone on
+	 * fractional powers (exp).
+	 */
+	for (int i = 0; i < NSAMPLES; i++)
+		inputs[i] = (int) (EXP_MIN*((rng_next(&rand_state) % 65536)/65536.0));
+	benchmark("expi", "legacy", legacy_exponential, reference_exponential);
+	benchmark("expi", "fast", exponential, reference_exponential);
+	for (int i = 0; i < NSAMPLES; i++)
+		inputs[i] = EXP_MIN*((rng_next(&rand_state) % 65536)/65536.0);
+	benchmark("exp", "fast", exponential, reference_exponential);
+
+	/* Power. */
+	for (int i = 0; i < NSAMPLES; i++)
+	{
+		inputs[i] = 0.5 + 1.5*((rng_next(&rand_state) % 65536)/65536.0);
+		exponents[i] = (rng_next(&rand_state) % (2*POW_MAX + 1)) - POW_MAX;
+	}
+	benchmark_powerd("legacy", legacy_powerd);
+	benchmark_powerd("fast", fast_powerd);
+
+	footprint_dump("[benchmarks][math]", 0);
+}
+
+/**
+ * @brief Math Library Benchmark
+ */
+int main(int argc, char **argv)
+{
+	((void) argc);
+	((void) argv);
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][math]");
+
+	kernel_math();
+
+	return (0);
+}
@@ -15,7 +15,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef __k1__
 #include <mppa/osconfig.h>
+#endif
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -37,6 +39,7 @@
  */
 /**@{*/
 static int NTHREADS; /**< Number of Working Threads */
+static int NROWS;    /**< Number of Lines Computed  */
 /**@}*/
 
 /**
@@ -47,15 +50,26 @@ struct tdata
 	int tnum; /**< Thread Number */
 	int i0;   /**< Start Line    */
 	int in;   /**< End Line      */
-} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS_MAX);
+
+#ifndef MM_OUT_OF_CORE
+
+/*============================================================================*
+ * In-Core Kernel                                                             *
+ *============================================================================*/
 
 /**
  * @brief Matrices.
  */
 /**@{*/
-static float a[MATSIZE*MATSIZE] ALIGN(CACHE_LINE_SIZE);
-static float b[MATSIZE*MATSIZE] ALIGN(CACHE_LINE_SIZE);
-static float ret[MATSIZE*MATSIZE] ALIGN(CACHE_LINE_SIZE);
+static float *a;
+static float *b;
+static float *ret;
 /**@}*/
 
 /**
@@ -67,38 +81,40 @@ static float ret[MATSIZE*MATSIZE] ALIGN(CACHE_LINE_SIZE);
  */
 static inline void benchmark_dump_stats(int it, int matsize, uint64_t *stats)
 {
+	uint64_t corrected[BENCHMARK_PERF_EVENTS];
+
+	perf_stats_check("[benchmarks][matrix]", it, NTHREADS, stats);
+	perf_overhead_correct(corrected, stats);
+
 #ifdef NDEBUG
-	printf("%s %d %d %d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+	char buf_raw[PERF_STATS_STRLEN];
+	char buf_corrected[PERF_STATS_STRLEN];
+
+	perf_stats_format(buf_raw, sizeof(buf_raw), stats);
+	perf_stats_format(buf_corrected, sizeof(buf_corrected), corrected);
+
+	printf("%s %d %d %d %s %s\n",
 		"[benchmarks][matrix]",
 		it,
 		NTHREADS,
 		matsize,
-		UINT32(stats[0]),
-		UINT32(stats[1]),
-		UINT32(stats[2]),
-		UINT32(stats[3]),
-		UINT32(stats[4]),
-		UINT32(stats[5]),
-		UINT32(stats[6]),
-		UINT32(stats[7]),
-		UINT32(stats[8]),
-		UINT32(stats[9]),
-		UINT32(stats[10]),
-		UINT32(stats[11]),
-		UINT32(stats[12]),
-		UINT32(stats[13])
+		buf_raw,
+		buf_corrected
 	);
 #else
 	UNUSED(it);
 
-	printf("%s nthreads=%d matsize=%d    time=%.2f s    flops=%.2f MFLOPS\n",
+	printf("%s nthreads=%d matsize=%d    time=%.6f s (%.6f s corrected)    flops=%.2f MFLOPS\n",
 		"[benchmarks][matrix]",
 		NTHREADS,
 		matsize,
-		(UINT32(stats[0])/FLOAT(CLUSTER_FREQ)),
-		(FLOAT(2*matsize*matsize*matsize)/NTHREADS)/(UINT32(stats[0])/FLOAT(CLUSTER_FREQ))
+		CYCLES_TO_SECONDS(stats[0]),
+		CYCLES_TO_SECONDS(corrected[0]),
+		(2*DOUBLE(NROWS)*matsize*matsize/NTHREADS)/CYCLES_TO_USECONDS(corrected[0])
 	);
 #endif
+
+	perf_metrics_dump("[benchmarks][matrix]", it, NTHREADS, corrected);
 }
 
 /**
@@ -176,12 +192,79 @@ static void *task(void *arg)
 		}
 
 		if (i >= SKIP)
+		{
 			benchmark_dump_stats(i - SKIP, MATSIZE, stats);
+			scaling_sample(t->tnum, i - SKIP, stats[BENCHMARK_PERF_CYCLES]);
+		}
 	}
 
 	return (NULL);
 }
 
+#ifdef OPENMP
+
+/**
+ * @brief Runs a pass of the pthread variant of the kernel.
+ */
+static void *task_pass(void *arg)
+{
+	struct tdata *t = arg;
+
+	matrix_mult(t->i0, t->in);
+
+	return (NULL);
+}
+
+/**
+ * @brief Compares the Matrix Multiplication Kernel against its OpenMP Variant
+ *
+ * @param nthreads Number of working threads.
+ */
+static void kernel_matrix_openmp(int nthreads)
+{
+	uint64_t best[OPENMP_NVARIANTS] = { UINT64_MAX, UINT64_MAX };
+
+	openmp_bind(nthreads);
+
+	for (int it = 0; it < (NITERATIONS + SKIP); it++)
+	{
+		matrix_init(0, NROWS);
+
+		for (int pass = 0; pass < OPENMP_NVARIANTS; pass++)
+		{
+			int variant = OPENMP_VARIANT(it, pass);
+			pthread_t tid[NTHREADS_MAX];
+			uint64_t start;
+			uint64_t end;
+
+			start = k1b_perf_timestamp();
+
+			if (variant == OPENMP_PTHREADS)
+			{
+				for (int i = 0; i < nthreads; i++)
+					affinity_thread_create(&tid[i], i, task_pass, PERTHREAD_GET(tdata, i));
+				for (int i = 0; i < nthreads; i++)
+					pthread_join(tid[i], NULL);
+			}
+			else
+			{
+				#pragma omp parallel for num_threads(nthreads) schedule(static)
+				for (int i = 0; i < NROWS; i++)
+					matrix_mult(i, i + 1);
+			}
+
+			end = k1b_perf_timestamp();
+
+			if ((it >= SKIP) && (end - start < best[variant]))
+				best[variant] = end - start;
+		}
+	}
+
+	openmp_dump("[benchmarks][matrix]", nthreads, best[OPENMP_PTHREADS], best[OPENMP_OPENMP]);
+}
+
+#endif
+
 /**
  * @brief Matrix Multiplication Benchmark Kernel
  *
@@ -195,32 +278,494 @@ static void kernel_matrix(int nthreads)
 	/* Save kernel parameters. */
 	NTHREADS = nthreads;
 
+	arena_reset();
+	a = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	b = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	ret = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+
+	if (ret == NULL)
+	{
+		arena_dump("[benchmarks][matrix]");
+		return;
+	}
+
+#ifdef WEAK_SCALING
+	/* Lines per thread are fixed, thus the output grows with threads. */
+	nrows = MATSIZE/NTHREADS_MAX;
+	NROWS = nrows*nthreads;
+#else
 	nrows = MATSIZE/nthreads;
+	NROWS = MATSIZE;
+#endif
 
 	/* Spawn threads. */
 	for (int i = 0; i < nthreads; i++)
 	{
 		/* Initialize thread data structure. */
-		tdata[i].i0 = nrows*i;
-		tdata[i].in = (i == (nthreads - 1)) ? MATSIZE : (i + 1)*nrows;
-		tdata[i].tnum = i;
+		PERTHREAD_GET(tdata, i)->i0 = nrows*i;
+		PERTHREAD_GET(tdata, i)->in = (i == (nthreads - 1)) ? NROWS : (i + 1)*nrows;
+		PERTHREAD_GET(tdata, i)->tnum = i;
 
-		pthread_create(&tid[i], NULL, task, &tdata[i]);
+		affinity_thread_create(&tid[i], i, task, PERTHREAD_GET(tdata, i));
 	}
 
 	/* Wait for threads. */
 	for (int i = 0; i < nthreads; i++)
 		pthread_join(tid[i], NULL);
+
+	/* Rows of a and ret, and all of b, are moved once. */
+	roofline_dump("[benchmarks][matrix]",
+		nthreads,
+		2*DOUBLE(NROWS)*MATSIZE*MATSIZE,
+		(2*DOUBLE(NROWS)*MATSIZE + DOUBLE(MATSIZE)*MATSIZE)*sizeof(float),
+		scaling_record(nthreads)
+	);
+	affinity_dump("[benchmarks][matrix]", nthreads);
+	footprint_dump("[benchmarks][matrix]", nthreads);
+
+#ifdef OPENMP
+	kernel_matrix_openmp(nthreads);
+#endif
+}
+
+#else
+
+/*============================================================================*
+ * Out-of-Core Kernel                                                         *
+ *============================================================================*/
+
+/**
+ * @name Out-of-Core Parameters
+ */
+/**@{*/
+#define OOC_MATSIZE                         512  /**< Matrix Size               */
+#define OOC_TILESIZE                         64  /**< Tile Size                 */
+#define OOC_NTILES   (OOC_MATSIZE/OOC_TILESIZE)  /**< Tiles per Row of a Matrix */
+/**@}*/
+
+/**
+ * @brief Size of a tile (in bytes).
+ */
+#define TILE_SIZE (OOC_TILESIZE*OOC_TILESIZE*sizeof(float))
+
+/**
+ * @brief Size of the backing store (in bytes).
+ */
+#define STORE_SIZE (3*OOC_NTILES*OOC_NTILES*TILE_SIZE)
+
+/**
+ * @brief Medium of the backing store.
+ */
+#ifdef __k1__
+	#define STORE "ddr"
+#else
+	#define STORE "file"
+#endif
+
+/**
+ * @name Matrices in the Backing Store
+ */
+/**@{*/
+#define MATRIX_A   0 /**< Matrix a   */
+#define MATRIX_B   1 /**< Matrix b   */
+#define MATRIX_RET 2 /**< Matrix ret */
+/**@}*/
+
+/**
+ * @name Staging Buffers
+ *
+ * Tiles are double buffered, so that the next ones are staged while
+ * the current ones are used.
+ */
+/**@{*/
+#define BUFFER_A(s)   (s)       /**< Tile of a                 */
+#define BUFFER_B(s)   (2 + (s)) /**< Tile of b                 */
+#define BUFFER_RET(s) (4 + (s)) /**< Tile of ret               */
+#define NBUFFERS      6         /**< Number of Staging Buffers */
+/**@}*/
+
+/**
+ * @brief Staging buffers.
+ */
+static float *tiles[NBUFFERS];
+
+/**
+ * @brief Barrier of working threads.
+ */
+static pthread_barrier_t barrier;
+
+/**
+ * @brief Execution statistics of the thread that stages tiles.
+ */
+static struct
+{
+	uint64_t total;   /**< Execution Time          */
+	uint64_t compute; /**< Time Multiplying Tiles  */
+	uint64_t stall;   /**< Time Waiting for Tiles  */
+} ostats;
+
+/**
+ * @brief Dump execution statistics of the out-of-core kernel.
+ *
+ * @param it Benchmark iteration.
+ */
+static inline void benchmark_dump_ooc(int it)
+{
+#ifdef NDEBUG
+	printf("%s %d %d %d %d %s %llu %llu %llu\n",
+		"[benchmarks][matrix][ooc]",
+		it,
+		NTHREADS,
+		OOC_MATSIZE,
+		OOC_TILESIZE,
+		STORE,
+		UINT64(ostats.total),
+		UINT64(ostats.compute),
+		UINT64(ostats.stall)
+	);
+#else
+	UNUSED(it);
+
+	printf("%s nthreads=%d matsize=%d tilesize=%d store=%s    time=%.6f s    compute=%.6f s    stall=%.6f s (%.1f%%)\n",
+		"[benchmarks][matrix][ooc]",
+		NTHREADS,
+		OOC_MATSIZE,
+		OOC_TILESIZE,
+		STORE,
+		CYCLES_TO_SECONDS(ostats.total),
+		CYCLES_TO_SECONDS(ostats.compute),
+		CYCLES_TO_SECONDS(ostats.stall),
+		100*DOUBLE(ostats.stall)/ostats.total
+	);
+#endif
+}
+
+/**
+ * @brief Returns the offset of a tile in the backing store. Tiles are
+ * stored contiguously, so that each one is a single transfer.
+ *
+ * @param matrix Target matrix.
+ * @param i      Row of the tile.
+ * @param j      Column of the tile.
+ */
+static inline size_t tile_offset(int matrix, int i, int j)
+{
+	return ((((size_t) matrix*OOC_NTILES + i)*OOC_NTILES + j)*TILE_SIZE);
+}
+
+/**
+ * @brief Starts staging the tiles of a step.
+ *
+ * Step s multiplies tile (i, k) of a and tile (k, j) of b into tile
+ * (i, j) of ret, for s = (i*OOC_NTILES + j)*OOC_NTILES + k.
+ *
+ * @param reqs_a Transfer requests of tiles of a.
+ * @param reqs_b Transfer requests of tiles of b.
+ * @param s      Target step.
+ */
+static inline void tiles_prefetch(int *reqs_a, int *reqs_b, int s)
+{
+	int i = s/(OOC_NTILES*OOC_NTILES);
+	int j = (s/OOC_NTILES)%OOC_NTILES;
+	int k = s%OOC_NTILES;
+
+	reqs_a[s%2] = store_get(BUFFER_A(s%2), tile_offset(MATRIX_A, i, k), TILE_SIZE);
+	reqs_b[s%2] = store_get(BUFFER_B(s%2), tile_offset(MATRIX_B, k, j), TILE_SIZE);
 }
 
+/**
+ * @brief Waits for a transfer once.
+ *
+ * @param req Target transfer request, reset upon return.
+ */
+static inline void tile_wait(int *req)
+{
+	store_wait(*req);
+	*req = -1;
+}
+
+/**
+ * @brief Multiplies a chunk of two tiles.
+ *
+ * @param ta    Tile of a.
+ * @param tb    Tile of b.
+ * @param tret  Tile of ret.
+ * @param i0    Start line.
+ * @param in    End line.
+ * @param first First tile product of @p tret?
+ */
+static inline void tile_mult(const float *ta, const float *tb, float *tret, int i0, int in, int first)
+{
+	for (int i = i0; i < in; ++i)
+	{
+		int ii = i*OOC_TILESIZE;
+
+		for (int j = 0; j < OOC_TILESIZE; ++j)
+		{
+			float c = first ? 0.0 : tret[ii + j];
+
+			for (int k = 0; k < OOC_TILESIZE; k += 4)
+			{
+				c += ta[ii + k]*tb[k*OOC_TILESIZE + j];
+				c += ta[ii + k + 1]*tb[(k + 1)*OOC_TILESIZE + j];
+				c += ta[ii + k + 2]*tb[(k + 2)*OOC_TILESIZE + j];
+				c += ta[ii + k + 3]*tb[(k + 3)*OOC_TILESIZE + j];
+			}
+
+			tret[ii + j] = c;
+		}
+	}
+}
+
+/**
+ * @brief Multiplies matrices in the backing store.
+ *
+ * All threads multiply a chunk of lines of every tile product, and
+ * thread 0 also stages tiles: it prefetches those of the next step
+ * and writes back tiles of ret while the current step is computed.
+ */
+static void *task_ooc(void *arg)
+{
+	struct tdata *t = arg;
+	int nsteps = OOC_NTILES*OOC_NTILES*OOC_NTILES;
+	int reqs_a[2] = { -1, -1 };
+	int reqs_b[2] = { -1, -1 };
+	int reqs_ret[2] = { -1, -1 };
+	uint64_t start = 0;
+	uint64_t t0, t1;
+
+	if (t->tnum == 0)
+	{
+		ostats.compute = 0;
+		ostats.stall = 0;
+
+		start = k1b_perf_timestamp();
+		tiles_prefetch(reqs_a, reqs_b, 0);
+	}
+
+	for (int s = 0; s < nsteps; s++)
+	{
+		int c = s/OOC_NTILES;
+		int k = s%OOC_NTILES;
+
+		/* Tiles of the last step are no longer used. */
+		pthread_barrier_wait(&barrier);
+
+		if (t->tnum == 0)
+		{
+			t0 = k1b_perf_timestamp();
+
+				tile_wait(&reqs_a[s%2]);
+				tile_wait(&reqs_b[s%2]);
+
+				/* Buffer of ret is still being written back. */
+				if (k == 0)
+					tile_wait(&reqs_ret[c%2]);
+
+			t1 = k1b_perf_timestamp();
+
+			ostats.stall += t1 - t0;
+
+			/* Last tile of ret is complete. */
+			if ((k == 0) && (c > 0))
+			{
+				reqs_ret[(c - 1)%2] = store_put(BUFFER_RET((c - 1)%2),
+					tile_offset(MATRIX_RET, (c - 1)/OOC_NTILES, (c - 1)%OOC_NTILES),
+					TILE_SIZE
+				);
+			}
+
+			if (s + 1 < nsteps)
+				tiles_prefetch(reqs_a, reqs_b, s + 1);
+		}
+
+		pthread_barrier_wait(&barrier);
+
+		t0 = k1b_perf_timestamp();
+
+			tile_mult(tiles[BUFFER_A(s%2)], tiles[BUFFER_B(s%2)], tiles[BUFFER_RET(c%2)], t->i0, t->in, k == 0);
+
+		t1 = k1b_perf_timestamp();
+
+		if (t->tnum == 0)
+			ostats.compute += t1 - t0;
+	}
+
+	pthread_barrier_wait(&barrier);
+
+	if (t->tnum == 0)
+	{
+		int c = OOC_NTILES*OOC_NTILES - 1;
+
+		reqs_ret[c%2] = store_put(BUFFER_RET(c%2), tile_offset(MATRIX_RET, c/OOC_NTILES, c%OOC_NTILES), TILE_SIZE);
+
+		t0 = k1b_perf_timestamp();
+
+			tile_wait(&reqs_ret[0]);
+			tile_wait(&reqs_ret[1]);
+
+		t1 = k1b_perf_timestamp();
+
+		ostats.stall += t1 - t0;
+		ostats.total = t1 - start;
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Out-of-Core Matrix Multiplication Benchmark Kernel
+ *
+ * @param nthreads Number of working threads.
+ */
+static void kernel_ooc(int nthreads)
+{
+	int nrows;
+	uint64_t best = UINT64_MAX;
+	pthread_t tid[NTHREADS_MAX];
+
+	/* Save kernel parameters. */
+	NTHREADS = nthreads;
+	NROWS = OOC_MATSIZE;
+
+	nrows = OOC_TILESIZE/nthreads;
+
+	pthread_barrier_init(&barrier, NULL, nthreads);
+
+	for (int it = 0; it < (NITERATIONS + SKIP); it++)
+	{
+		/* Spawn threads. */
+		for (int i = 0; i < nthreads; i++)
+		{
+			/* Initialize thread data structure. */
+			PERTHREAD_GET(tdata, i)->i0 = nrows*i;
+			PERTHREAD_GET(tdata, i)->in = (i == (nthreads - 1)) ? OOC_TILESIZE : (i + 1)*nrows;
+			PERTHREAD_GET(tdata, i)->tnum = i;
+
+			affinity_thread_create(&tid[i], i, task_ooc, PERTHREAD_GET(tdata, i));
+		}
+
+		/* Wait for threads. */
+		for (int i = 0; i < nthreads; i++)
+			pthread_join(tid[i], NULL);
+
+		if (it >= SKIP)
+		{
+			benchmark_dump_ooc(it - SKIP);
+
+			if (ostats.total < best)
+				best = ostats.total;
+		}
+	}
+
+	pthread_barrier_destroy(&barrier);
+
+	/* Tiles of a and b are staged once per product, and tiles of ret once. */
+	roofline_dump("[benchmarks][matrix][ooc]",
+		nthreads,
+		2*DOUBLE(NROWS)*OOC_MATSIZE*OOC_MATSIZE,
+		(2*DOUBLE(OOC_NTILES) + 1)*OOC_NTILES*OOC_NTILES*TILE_SIZE,
+		best
+	);
+	affinity_dump("[benchmarks][matrix][ooc]", nthreads);
+	footprint_dump("[benchmarks][matrix][ooc]", nthreads);
+}
+
+/**
+ * @brief Out-of-Core Matrix Multiplication Benchmark
+ *
+ * @param clusterid Cluster ID.
+ * @param nclusters Number of clusters.
+ */
+static int benchmark_ooc(int clusterid, int nclusters)
+{
+	UNUSED(clusterid);
+	UNUSED(nclusters);
+
+	for (int i = 0; i < NBUFFERS; i++)
+	{
+		if ((tiles[i] = store_buffer(i, TILE_SIZE)) == NULL)
+			return (-1);
+	}
+
+	if (store_open(STORE_SIZE) < 0)
+		return (-1);
+
+	/* Fill a and b, one tile at a time. */
+	for (int i = 0; i < OOC_TILESIZE*OOC_TILESIZE; i++)
+		tiles[BUFFER_A(0)][i] = 1.0;
+	for (int m = MATRIX_A; m <= MATRIX_B; m++)
+	{
+		for (int i = 0; i < OOC_NTILES; i++)
+		{
+			for (int j = 0; j < OOC_NTILES; j++)
+				store_wait(store_put(BUFFER_A(0), tile_offset(m, i, j), TILE_SIZE));
+		}
+	}
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][matrix]");
+
+#ifndef NDEBUG
+
+	kernel_ooc(NTHREADS_MAX);
+
+#else
+
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+		kernel_ooc(nthreads);
+
+#endif
+
+	store_close();
+
+	return (0);
+}
+
+#endif
+
 /**
  * @brief Matrix Multiplication Benchmark
  */
 int main(int argc, char **argv)
 {
+#if defined(MM_OUT_OF_CORE) && defined(__node__)
+
+	return (transport_worker(argc, argv, benchmark_ooc));
+
+#elif defined(MM_OUT_OF_CORE) && defined(__k1__)
+
+	int ret;
+
 	((void) argc);
 	((void) argv);
 
+	/* The IO cluster keeps matrices in DDR for a compute cluster. */
+	if (transport_spawn(1, CCLUSTER_BINARY, benchmark_ooc) < 0)
+		return (-1);
+
+	ret = store_serve(STORE_SIZE);
+
+	if (transport_join() < 0)
+		ret = -1;
+
+	return (ret);
+
+#elif defined(MM_OUT_OF_CORE)
+
+	((void) argc);
+	((void) argv);
+
+	return (benchmark_ooc(0, 1));
+
+#else
+
+	((void) argc);
+	((void) argv);
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][matrix]");
+
 #ifndef NDEBUG
 
 	kernel_matrix(NTHREADS_MAX);
@@ -230,7 +775,11 @@ int main(int argc, char **argv)
 	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
 		kernel_matrix(nthreads);
 
+	scaling_dump("[benchmarks][matrix]");
+
 #endif
 
 	return (0);
+
+#endif
 }
@@ -0,0 +1,751 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The master owns inputs and outputs, and streams blocks of them to
+ * workers, which compute each block with all of their cores. On the
+ * MPPA-256, the master runs in the IO cluster, data lives in DDR and
+ * workers are compute clusters.
+ */
+
+#ifdef __k1__
+#include <mppa/osconfig.h>
+#endif
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS               (NUM_CORES - 1) /**< Working Threads of a Worker          */
+#define NCLUSTERS_MIN                       1  /**< Minimum Number of Workers            */
+#define NCLUSTERS_MAX  TRANSPORT_CLUSTERS_MAX  /**< Maximum Number of Workers            */
+#define NBUFFERS_MAX                        2  /**< Maximum Number of Buffers per Stream */
+#define MATSIZE                           256  /**< Matrix Size                          */
+#define BLOCKROWS                          16  /**< Rows of a Matrix Block               */
+#define MASKSIZE                            7  /**< Mask Size                            */
+#define IMGSIZE          (2048 + MASKSIZE - 1) /**< Image Size                           */
+#define STRIPROWS                          64  /**< Output Rows of an Image Strip        */
+/**@}*/
+
+/**
+ * @brief Output rows of the image.
+ */
+#define OUTROWS (IMGSIZE - (MASKSIZE - 1))
+
+/**
+ * @name Kernels
+ */
+/**@{*/
+#define KERNEL_MM 0 /**< Matrix Multiplication */
+#define KERNEL_GF 1 /**< Gaussian Filter       */
+#define NKERNELS  2 /**< Number of Kernels     */
+/**@}*/
+
+/**
+ * @name Inbox Slots of Workers
+ */
+/**@{*/
+#define SLOT_JOB            0 /**< Job Description  */
+#define SLOT_CONST          1 /**< Data Sent Once   */
+#define SLOT_INPUT(b) (2 + (b)) /**< Input of a Block */
+/**@}*/
+
+/**
+ * @name Inbox Slots of the Master
+ */
+/**@{*/
+#define SLOT_STATS(c)     (c)                                                /**< Statistics of a Worker */
+#define SLOT_RESULT(c, b) (TRANSPORT_CLUSTERS_MAX + (c)*NBUFFERS_MAX + (b)) /**< Output of a Block      */
+/**@}*/
+
+/**
+ * @brief Computes rows of a block.
+ *
+ * @param cst    Data sent once.
+ * @param input  Input of the block.
+ * @param output Output of the block.
+ * @param i0     Start row.
+ * @param in     End row.
+ */
+typedef void (*compute_fn)(const void *cst, const void *input, void *output, int i0, int in);
+
+static void mm_compute(const void *cst, const void *input, void *output, int i0, int in);
+static void gf_compute(const void *cst, const void *input, void *output, int i0, int in);
+
+/**
+ * @brief Kernel table.
+ */
+static const struct kernel
+{
+	const char *name;   /**< Name                            */
+	size_t cst_size;    /**< Data Sent Once (in bytes)       */
+	size_t in_size;     /**< Input of a Block (in bytes)     */
+	size_t in_stride;   /**< Distance between Inputs         */
+	size_t out_size;    /**< Output of a Block (in bytes)    */
+	int nrows;          /**< Output Rows of a Block          */
+	int nblocks;        /**< Number of Blocks                */
+	compute_fn compute; /**< Computes Rows of a Block        */
+} kernels[NKERNELS] = {
+	{
+		"mm",
+		MATSIZE*MATSIZE*sizeof(float),
+		BLOCKROWS*MATSIZE*sizeof(float),
+		BLOCKROWS*MATSIZE*sizeof(float),
+		BLOCKROWS*MATSIZE*sizeof(float),
+		BLOCKROWS,
+		MATSIZE/BLOCKROWS,
+		mm_compute
+	},
+	{
+		"gf",
+		MASKSIZE*MASKSIZE*sizeof(double),
+		(STRIPROWS + MASKSIZE - 1)*IMGSIZE*sizeof(unsigned char),
+		STRIPROWS*IMGSIZE*sizeof(unsigned char),
+		STRIPROWS*IMGSIZE*sizeof(unsigned char),
+		STRIPROWS,
+		OUTROWS/STRIPROWS,
+		gf_compute
+	},
+};
+
+/**
+ * @brief Job of a worker.
+ */
+struct job
+{
+	int kernel;      /**< Kernel                 */
+	int nbuffers;    /**< Buffers per Stream     */
+	int niterations; /**< Number of Iterations   */
+	int nblocks;     /**< Blocks of the Worker   */
+};
+
+/**
+ * @brief Statistics of a worker in an iteration.
+ */
+struct wstats
+{
+	uint64_t compute; /**< Cycles Computing Blocks             */
+	uint64_t stall;   /**< Cycles Waiting for Input Blocks     */
+};
+
+/*============================================================================*
+ * Kernels                                                                    *
+ *============================================================================*/
+
+/**
+ * @brief Multiplies rows of a block of matrix a by matrix b.
+ */
+static void mm_compute(const void *cst, const void *input, void *output, int i0, int in)
+{
+	const float *b = cst;
+	const float *a = input;
+	float *ret = output;
+
+	for (int i = i0; i < in; i++)
+	{
+		for (int j = 0; j < MATSIZE; j++)
+		{
+			float c = 0;
+
+			for (int k = 0; k < MATSIZE; k++)
+				c += a[i*MATSIZE + k]*b[k*MATSIZE + j];
+
+			ret[i*MATSIZE + j] = c;
+		}
+	}
+}
+
+/**
+ * @brief Filters rows of an image strip. Inputs carry MASKSIZE/2 rows
+ * of halo above and below the strip.
+ */
+static void gf_compute(const void *cst, const void *input, void *output, int i0, int in)
+{
+	const double *mask = cst;
+	const unsigned char *img = input;
+	unsigned char *out = output;
+	int half = MASKSIZE >> 1;
+
+	for (int i = i0; i < in; i++)
+	{
+		for (int j = half; j < IMGSIZE - half; j++)
+		{
+			double pixel = 0.0;
+
+			for (int maskI = 0; maskI < MASKSIZE; maskI++)
+			{
+				for (int maskJ = 0; maskJ < MASKSIZE; maskJ++)
+				{
+					pixel +=
+						img[(i + maskI)*IMGSIZE + j + maskJ - half]*
+						mask[maskI*MASKSIZE + maskJ];
+				}
+			}
+
+			out[i*IMGSIZE + j] = (pixel > 255) ? 255 : (unsigned char) pixel;
+		}
+	}
+}
+
+/*============================================================================*
+ * Worker                                                                     *
+ *============================================================================*/
+
+/**
+ * @brief Task info.
+ */
+struct tdata
+{
+	int tnum;            /**< Thread Number    */
+	int i0;              /**< Start Row        */
+	int in;              /**< End Row          */
+	const void *cst;     /**< Data Sent Once   */
+	const void *input;   /**< Input of Block   */
+	void *output;        /**< Output of Block  */
+	compute_fn compute;  /**< Computes Rows    */
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS);
+
+/**
+ * @brief Computes rows of a block.
+ */
+static void *task(void *arg)
+{
+	struct tdata *t = arg;
+
+	t->compute(t->cst, t->input, t->output, t->i0, t->in);
+
+	/* Worker sends it. */
+	dcache_invalidate();
+
+	return (NULL);
+}
+
+/**
+ * @brief Computes a block with all cores of the worker.
+ */
+static void block_compute(const struct kernel *k, const void *cst, const void *input, void *output)
+{
+	int nrows = (k->nrows + NTHREADS - 1)/NTHREADS;
+	pthread_t tid[NTHREADS];
+
+	/* Input was written by the NoC. */
+	dcache_invalidate();
+
+	for (int i = 0; i < NTHREADS; i++)
+	{
+		struct tdata *t = PERTHREAD_GET(tdata, i);
+
+		t->tnum = i;
+		t->i0 = (nrows*i < k->nrows) ? nrows*i : k->nrows;
+		t->in = (nrows*(i + 1) < k->nrows) ? nrows*(i + 1) : k->nrows;
+		t->cst = cst;
+		t->input = input;
+		t->output = output;
+		t->compute = k->compute;
+
+		affinity_thread_create(&tid[i], i, task, t);
+	}
+
+	for (int i = 0; i < NTHREADS; i++)
+		pthread_join(tid[i], NULL);
+
+	dcache_invalidate();
+}
+
+/**
+ * @brief Main routine of a worker.
+ *
+ * @param clusterid ID of the worker.
+ * @param nclusters Number of workers.
+ */
+static int worker(int clusterid, int nclusters)
+{
+	struct job *job;
+	const struct kernel *k;
+	void *cst;
+	void *inputs[NBUFFERS_MAX];
+	void *outputs[NBUFFERS_MAX];
+	int reqs[NBUFFERS_MAX];
+	struct wstats stats;
+
+	UNUSED(nclusters);
+
+	/* Inbox slots and outputs share the arena. */
+	arena_reset();
+
+	if ((job = transport_open(SLOT_JOB, sizeof(struct job))) == NULL)
+		return (-1);
+
+	transport_barrier();
+	transport_wait(SLOT_JOB);
+
+	k = &kernels[job->kernel];
+
+	if ((cst = transport_open(SLOT_CONST, k->cst_size)) == NULL)
+	{
+		arena_dump("[benchmarks][offload]");
+		return (-1);
+	}
+
+	for (int b = 0; b < job->nbuffers; b++)
+	{
+		inputs[b] = transport_open(SLOT_INPUT(b), k->in_size);
+		outputs[b] = arena_alloc(k->out_size);
+
+		if ((inputs[b] == NULL) || (outputs[b] == NULL))
+		{
+			arena_dump("[benchmarks][offload]");
+			return (-1);
+		}
+
+		reqs[b] = -1;
+	}
+
+	transport_barrier();
+	transport_wait(SLOT_CONST);
+
+	for (int it = 0; it < job->niterations; it++)
+	{
+		stats.compute = 0;
+		stats.stall = 0;
+
+		for (int j = 0; j < job->nblocks; j++)
+		{
+			int b = j%job->nbuffers;
+			uint64_t t0, t1, t2;
+
+			t0 = k1b_perf_timestamp();
+
+				transport_wait(SLOT_INPUT(b));
+
+			t1 = k1b_perf_timestamp();
+
+				/* Output buffer is still being sent. */
+				transport_send_wait(reqs[b]);
+				block_compute(k, cst, inputs[b], outputs[b]);
+
+			t2 = k1b_perf_timestamp();
+
+			reqs[b] = transport_send(TRANSPORT_MASTER, SLOT_RESULT(clusterid, b), outputs[b], k->out_size, 0);
+
+			stats.stall += t1 - t0;
+			stats.compute += t2 - t1;
+		}
+
+		transport_send(TRANSPORT_MASTER, SLOT_STATS(clusterid), &stats, sizeof(struct wstats), 0);
+		transport_flush();
+	}
+
+	transport_close();
+
+	return (0);
+}
+
+#ifndef __node__
+
+/*============================================================================*
+ * Master                                                                     *
+ *============================================================================*/
+
+/**
+ * @name Data of the Master
+ */
+/**@{*/
+static float *mm_a;              /**< Matrix a     */
+static float *mm_b;              /**< Matrix b     */
+static float *mm_ret;            /**< Matrix ret   */
+static double *gf_mask;          /**< Mask         */
+static unsigned char *gf_img;    /**< Image        */
+static unsigned char *gf_output; /**< Output Image */
+/**@}*/
+
+/**
+ * @brief Buffers of the master.
+ */
+static struct
+{
+	const void *cst; /**< Data Sent Once */
+	const char *in;  /**< Inputs         */
+	char *out;       /**< Outputs        */
+} buffers[NKERNELS];
+
+/**
+ * @brief Allocates and initializes data of the master.
+ *
+ * @returns Zero upon success, and a negative number otherwise.
+ */
+static int data_init(void)
+{
+	struct rng_state state;
+	int half = MASKSIZE >> 1;
+	double total = 0.0;
+
+	arena_reset();
+	mm_a = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	mm_b = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	mm_ret = arena_alloc(MATSIZE*MATSIZE*sizeof(float));
+	gf_mask = arena_alloc(MASKSIZE*MASKSIZE*sizeof(double));
+	gf_img = arena_alloc(IMGSIZE*IMGSIZE*sizeof(unsigned char));
+	gf_output = arena_alloc(OUTROWS*IMGSIZE*sizeof(unsigned char));
+
+	arena_dump("[benchmarks][offload]");
+
+	if (gf_output == NULL)
+		return (-1);
+
+	buffers[KERNEL_MM].cst = mm_b;
+	buffers[KERNEL_MM].in = (const char *) mm_a;
+	buffers[KERNEL_MM].out = (char *) mm_ret;
+	buffers[KERNEL_GF].cst = gf_mask;
+	buffers[KERNEL_GF].in = (const char *) gf_img;
+	buffers[KERNEL_GF].out = (char *) gf_output;
+
+	for (int i = 0; i < MATSIZE*MATSIZE; i++)
+	{
+		mm_a[i] = 1.0;
+		mm_b[i] = 1.0;
+	}
+
+	for (int i = -half; i <= half; i++)
+	{
+		for (int j = -half; j <= half; j++)
+		{
+			gf_mask[(i + half)*MASKSIZE + j + half] =
+				exponential(-((i*i + j*j)/2.0*SD*SD))/(2.0*PI*SD*SD);
+			total += gf_mask[(i + half)*MASKSIZE + j + half];
+		}
+	}
+
+	for (int i = 0; i < MASKSIZE*MASKSIZE; i++)
+		gf_mask[i] /= total;
+
+	rng_initialize(&state);
+	for (int i = 0; i < IMGSIZE*IMGSIZE; i++)
+		gf_img[i] = rng_next(&state) & 0xff;
+
+	return (0);
+}
+
+/**
+ * @brief Dump statistics of a worker.
+ *
+ * @param it        Benchmark iteration.
+ * @param k         Target kernel.
+ * @param nclusters Number of workers.
+ * @param nbuffers  Buffers per stream.
+ * @param clusterid ID of the worker.
+ * @param nblocks   Blocks of the worker.
+ * @param stats     Statistics of the worker.
+ */
+static inline void benchmark_dump_cluster(int it, const struct kernel *k, int nclusters, int nbuffers, int clusterid, int nblocks, const struct wstats *stats)
+{
+#ifdef NDEBUG
+	printf("%s %d %s %d %d %d %d %llu %llu\n",
+		"[benchmarks][offload][cluster]",
+		it,
+		k->name,
+		nclusters,
+		nbuffers,
+		clusterid,
+		nblocks,
+		UINT64(stats->compute),
+		UINT64(stats->stall)
+	);
+#else
+	UNUSED(it);
+
+	printf("%s kernel=%s    clusters=%d    buffers=%d    cluster=%d    blocks=%d    compute=%.6f s    stall=%.6f s\n",
+		"[benchmarks][offload][cluster]",
+		k->name,
+		nclusters,
+		nbuffers,
+		clusterid,
+		nblocks,
+		CYCLES_TO_SECONDS(stats->compute),
+		CYCLES_TO_SECONDS(stats->stall)
+	);
+#endif
+}
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * The slowest worker gives the compute time, and the rest of the
+ * stream is communication that was not hidden, or load imbalance.
+ *
+ * @param it        Benchmark iteration.
+ * @param k         Target kernel.
+ * @param nclusters Number of workers.
+ * @param nbuffers  Buffers per stream.
+ * @param total     Cycles of the master to stream all blocks.
+ * @param stats     Statistics of workers.
+ */
+static inline void benchmark_dump_stats(int it, const struct kernel *k, int nclusters, int nbuffers, uint64_t total, struct wstats *const *stats)
+{
+	uint64_t bytes;
+	uint64_t compute = 0;
+	uint64_t stall = 0;
+	uint64_t comm;
+	double overlap;
+
+	for (int i = 0; i < nclusters; i++)
+	{
+		if (stats[i]->compute > compute)
+			compute = stats[i]->compute;
+		if (stats[i]->stall > stall)
+			stall = stats[i]->stall;
+	}
+
+	bytes = ((uint64_t) k->nblocks)*(k->in_size + k->out_size) + ((uint64_t) nclusters)*k->cst_size;
+	comm = (total > compute) ? total - compute : 0;
+
+	/* Fraction of the stream spent computing. */
+	overlap = (total > 0) ? DOUBLE(compute)/total : 0.0;
+
+#ifdef NDEBUG
+	printf("%s %d %s %d %d %d %llu %llu %llu %llu %llu %.3f\n",
+		"[benchmarks][offload]",
+		it,
+		k->name,
+		nclusters,
+		nbuffers,
+		k->nblocks,
+		UINT64(bytes),
+		UINT64(total),
+		UINT64(compute),
+		UINT64(stall),
+		UINT64(comm),
+		overlap
+	);
+#else
+	UNUSED(it);
+	UNUSED(bytes);
+
+	printf("%s kernel=%s    clusters=%d    buffers=%d    time=%.6f s    compute=%.6f s    stall=%.6f s    comm=%.6f s    overlap=%.1f%%\n",
+		"[benchmarks][offload]",
+		k->name,
+		nclusters,
+		nbuffers,
+		CYCLES_TO_SECONDS(total),
+		CYCLES_TO_SECONDS(compute),
+		CYCLES_TO_SECONDS(stall),
+		CYCLES_TO_SECONDS(comm),
+		overlap*100
+	);
+#endif
+}
+
+/**
+ * @brief Sends a block to its worker.
+ *
+ * @param k      Target kernel.
+ * @param kernel Target kernel number.
+ * @param c      Target worker.
+ * @param block  Block number.
+ * @param buf    Buffer of the worker.
+ */
+static inline void block_send(const struct kernel *k, int kernel, int c, int block, int buf)
+{
+	transport_send(c, SLOT_INPUT(buf), buffers[kernel].in + block*k->in_stride, k->in_size, 0);
+}
+
+/**
+ * @brief Offload Benchmark Kernel
+ *
+ * Blocks are partitioned in contiguous ranges across workers. Image
+ * strips carry their halo rows, thus workers never exchange data.
+ *
+ * @param kernel    Target kernel.
+ * @param nclusters Number of workers.
+ * @param nbuffers  Buffers per stream.
+ */
+static int kernel_offload(int kernel, int nclusters, int nbuffers)
+{
+	const struct kernel *k = &kernels[kernel];
+	struct job jobs[TRANSPORT_CLUSTERS_MAX];
+	int first[TRANSPORT_CLUSTERS_MAX];
+	char *results[TRANSPORT_CLUSTERS_MAX][NBUFFERS_MAX];
+	struct wstats *stats[TRANSPORT_CLUSTERS_MAX];
+	int nrounds = 0;
+
+	for (int c = 0; c < nclusters; c++)
+	{
+		for (int i = 0; i < nbuffers; i++)
+		{
+			if ((results[c][i] = transport_open(SLOT_RESULT(c, i), k->out_size)) == NULL)
+				return (-1);
+		}
+
+		if ((stats[c] = transport_open(SLOT_STATS(c), sizeof(struct wstats))) == NULL)
+			return (-1);
+
+		first[c] = (c*k->nblocks)/nclusters;
+
+		jobs[c].kernel = kernel;
+		jobs[c].nbuffers = nbuffers;
+		jobs[c].niterations = NITERATIONS + SKIP;
+		jobs[c].nblocks = ((c + 1)*k->nblocks)/nclusters - first[c];
+
+		if (jobs[c].nblocks > nrounds)
+			nrounds = jobs[c].nblocks;
+	}
+
+	if (transport_spawn(nclusters, CCLUSTER_BINARY, worker) < 0)
+		return (-1);
+
+	transport_barrier();
+	for (int c = 0; c < nclusters; c++)
+		transport_send(c, SLOT_JOB, &jobs[c], sizeof(struct job), 0);
+	transport_barrier();
+	for (int c = 0; c < nclusters; c++)
+		transport_send(c, SLOT_CONST, buffers[kernel].cst, k->cst_size, 0);
+
+	for (int it = 0; it < (NITERATIONS + SKIP); it++)
+	{
+		uint64_t t0, t1;
+
+		t0 = k1b_perf_timestamp();
+
+		/* Fill pipelines. */
+		for (int c = 0; c < nclusters; c++)
+		{
+			for (int j = 0; (j < nbuffers) && (j < jobs[c].nblocks); j++)
+				block_send(k, kernel, c, first[c] + j, j);
+		}
+
+		/* Collect results from all workers in turn. */
+		for (int j = 0; j < nrounds; j++)
+		{
+			int b = j%nbuffers;
+
+			for (int c = 0; c < nclusters; c++)
+			{
+				if (j >= jobs[c].nblocks)
+					continue;
+
+				transport_wait(SLOT_RESULT(c, b));
+
+				/* Output was written by the NoC. */
+				dcache_invalidate();
+				memcpy(buffers[kernel].out + (first[c] + j)*k->out_size, results[c][b], k->out_size);
+
+				/* The buffer is free again. */
+				if (j + nbuffers < jobs[c].nblocks)
+					block_send(k, kernel, c, first[c] + j + nbuffers, b);
+			}
+		}
+
+		t1 = k1b_perf_timestamp();
+
+		for (int c = 0; c < nclusters; c++)
+			transport_wait(SLOT_STATS(c));
+		dcache_invalidate();
+
+		if (it >= SKIP)
+		{
+			for (int c = 0; c < nclusters; c++)
+				benchmark_dump_cluster(it - SKIP, k, nclusters, nbuffers, c, jobs[c].nblocks, stats[c]);
+
+			benchmark_dump_stats(it - SKIP, k, nclusters, nbuffers, t1 - t0, stats);
+		}
+	}
+
+	transport_flush();
+
+	if (transport_join() < 0)
+		return (-1);
+
+	transport_close();
+
+	return (0);
+}
+
+/**
+ * @brief Runs a kernel with all buffering schemes.
+ *
+ * @param kernel    Target kernel.
+ * @param nclusters Number of workers.
+ */
+static int benchmark_offload(int kernel, int nclusters)
+{
+	for (int nbuffers = 1; nbuffers <= NBUFFERS_MAX; nbuffers++)
+	{
+		if (kernel_offload(kernel, nclusters, nbuffers) < 0)
+		{
+			fprintf(stderr, "[benchmarks][offload] failed to offload %s\n", kernels[kernel].name);
+			return (-1);
+		}
+	}
+
+	return (0);
+}
+
+#endif
+
+/**
+ * @brief Offload Benchmark
+ */
+int main(int argc, char **argv)
+{
+#ifdef __node__
+
+	return (transport_worker(argc, argv, worker));
+
+#else
+
+	((void) argc);
+	((void) argv);
+
+	if (data_init() < 0)
+		return (1);
+
+#ifndef NDEBUG
+
+	for (int kernel = 0; kernel < NKERNELS; kernel++)
+	{
+		if (benchmark_offload(kernel, NCLUSTERS_MAX) < 0)
+			return (1);
+	}
+
+#else
+
+	for (int kernel = 0; kernel < NKERNELS; kernel++)
+	{
+		for (int nclusters = NCLUSTERS_MIN; nclusters <= NCLUSTERS_MAX; nclusters *= 2)
+		{
+			if (benchmark_offload(kernel, nclusters) < 0)
+				return (1);
+		}
+	}
+
+#endif
+
+	return (0);
+
+#endif
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef __k1__
+#include <mppa/osconfig.h>
+#endif
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN               1  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX  (NUM_CORES - 1) /**< Maximum Number of Working Threads      */
+#define NTHREADS_STEP              1  /**< Increment on Number of Working Threads */
+#define SCALAR                   3.0  /**< Scalar of Scale and Triad              */
+/**@}*/
+
+/**
+ * @name Array Sizes (in bytes)
+ *
+ * Sizes double from three arrays that fit in the data cache up to the
+ * largest arrays that fit in the memory of the cluster. Static data of
+ * the IO cluster is placed in DDR.
+ */
+/**@{*/
+#define ARRAY_SIZE_MIN (CACHE_SIZE/4)
+#if defined(__node__)
+	#define ARRAY_SIZE_MAX (256*1024)
+	#define MEMORY "smem"
+#elif defined(__k1__)
+	#define ARRAY_SIZE_MAX (8*1024*1024)
+	#define MEMORY "ddr"
+#else
+	#define ARRAY_SIZE_MAX (8*1024*1024)
+	#define MEMORY "host"
+#endif
+/**@}*/
+
+/**
+ * @brief Maximum number of elements in an array.
+ */
+#define NELEMENTS_MAX (ARRAY_SIZE_MAX/sizeof(double))
+
+/**
+ * @brief Elements in a cache line.
+ */
+#define LINE_NELEMENTS (CACHE_LINE_SIZE/sizeof(double))
+
+/**
+ * @name Operations
+ */
+/**@{*/
+#define OP_COPY  0 /**< c = a                */
+#define OP_SCALE 1 /**< b = s*c              */
+#define OP_ADD   2 /**< c = a + b            */
+#define OP_TRIAD 3 /**< a = b + s*c          */
+#define NOPS     4 /**< Number of Operations */
+/**@}*/
+
+/**
+ * @brief Operation table.
+ */
+static const struct
+{
+	const char *name; /**< Name                               */
+	int narrays;      /**< Arrays Read or Written per Element */
+} ops[NOPS] = {
+	{ "copy",  2 },
+	{ "scale", 2 },
+	{ "add",   3 },
+	{ "triad", 3 },
+};
+
+/**
+ * @name Arrays
+ */
+/**@{*/
+static double *a; /**< Array a */
+static double *b; /**< Array b */
+static double *c; /**< Array c */
+/**@}*/
+
+/**
+ * @brief Task info.
+ */
+struct tdata
+{
+	int tnum;                           /**< Thread Number            */
+	int i0;                             /**< Start Element            */
+	int in;                             /**< End Element              */
+	uint64_t cycles[NOPS][NITERATIONS]; /**< Cycles of Each Operation */
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS_MAX);
+
+/**
+ * @brief Barrier of working threads.
+ */
+static pthread_barrier_t barrier;
+
+/**
+ * @name Benchmark Kernel Parameters
+ */
+/**@{*/
+static int NTHREADS;  /**< Number of Working Threads */
+static int NELEMENTS; /**< Elements per Array        */
+/**@}*/
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param op     Operation.
+ * @param cycles Parallel execution time.
+ */
+static inline void benchmark_dump_stats(int it, int op, uint64_t cycles)
+{
+	uint64_t bytes;
+	double bandwidth;
+
+	bytes = ((uint64_t) ops[op].narrays)*NELEMENTS*sizeof(double);
+
+	/* Bytes per microsecond, scaled to GB/s. */
+	bandwidth = (cycles > 0) ? DOUBLE(bytes)/CYCLES_TO_USECONDS(cycles)/1000 : 0.0;
+
+#ifdef NDEBUG
+	printf("%s %d %d %s %s %llu %llu %llu %.3f\n",
+		"[benchmarks][stream]",
+		it,
+		NTHREADS,
+		MEMORY,
+		ops[op].name,
+		UINT64(NELEMENTS*sizeof(double)),
+		UINT64(bytes),
+		UINT64(cycles),
+		bandwidth
+	);
+#else
+	UNUSED(it);
+
+	printf("%s nthreads=%d    memory=%s    op=%-5s    size=%llu B    bandwidth=%.3f GB/s\n",
+		"[benchmarks][stream]",
+		NTHREADS,
+		MEMORY,
+		ops[op].name,
+		UINT64(NELEMENTS*sizeof(double)),
+		bandwidth
+	);
+#endif
+}
+
+/**
+ * @brief Runs an operation over a chunk of the arrays.
+ *
+ * @param op Operation.
+ * @param i0 Start element.
+ * @param in End element.
+ */
+static void stream(int op, int i0, int in)
+{
+	switch (op)
+	{
+		case OP_COPY:
+			for (int i = i0; i < in; i++)
+				c[i] = a[i];
+			break;
+
+		case OP_SCALE:
+			for (int i = i0; i < in; i++)
+				b[i] = SCALAR*c[i];
+			break;
+
+		case OP_ADD:
+			for (int i = i0; i < in; i++)
+				c[i] = a[i] + b[i];
+			break;
+
+		case OP_TRIAD:
+			for (int i = i0; i < in; i++)
+				a[i] = b[i] + SCALAR*c[i];
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+ * @brief Runs all operations over the chunk of a thread.
+ */
+static void *task(void *arg)
+{
+	struct tdata *t = arg;
+
+	/* Each thread touches its own chunk first. */
+	for (int i = t->i0; i < t->in; i++)
+	{
+		a[i] = 1.0;
+		b[i] = 2.0;
+		c[i] = 0.0;
+	}
+
+	for (int op = 0; op < NOPS; op++)
+	{
+		for (int i = 0; i < (NITERATIONS + SKIP); i++)
+		{
+			uint64_t cycles;
+
+			/* Share memory bandwidth with all threads. */
+			pthread_barrier_wait(&barrier);
+
+			k1b_perf_start(0, K1B_PERF_CYCLES);
+
+				stream(op, t->i0, t->in);
+
+			k1b_perf_stop(0);
+
+			cycles = k1b_perf_read(0);
+
+			if (i >= SKIP)
+				t->cycles[op][i - SKIP] = perf_overhead_subtract(BENCHMARK_PERF_CYCLES, cycles);
+		}
+	}
+
+	/* Master reads it. */
+	dcache_invalidate();
+
+	return (NULL);
+}
+
+/**
+ * @brief Memory Bandwidth Benchmark Kernel
+ *
+ * @param nthreads  Number of working threads.
+ * @param nelements Elements per array.
+ */
+static void kernel_stream(int nthreads, int nelements)
+{
+	int chunk;
+	pthread_t tid[NTHREADS_MAX];
+
+	/* Save kernel parameters. */
+	NTHREADS = nthreads;
+	NELEMENTS = nelements;
+
+	arena_reset();
+	a = arena_alloc(nelements*sizeof(double));
+	b = arena_alloc(nelements*sizeof(double));
+	c = arena_alloc(nelements*sizeof(double));
+
+	if (c == NULL)
+	{
+		arena_dump("[benchmarks][stream]");
+		return;
+	}
+
+	/* Chunks start at cache line boundaries and cover all elements. */
+	chunk = ((nelements + nthreads - 1)/nthreads + LINE_NELEMENTS - 1) & ~(LINE_NELEMENTS - 1);
+
+	pthread_barrier_init(&barrier, NULL, nthreads);
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		struct tdata *t = PERTHREAD_GET(tdata, i);
+
+		/* Initialize thread data structure. */
+		t->tnum = i;
+		t->i0 = (chunk*i < nelements) ? chunk*i : nelements;
+		t->in = ((i < (nthreads - 1)) && (chunk*(i + 1) < nelements)) ? chunk*(i + 1) : nelements;
+
+		affinity_thread_create(&tid[i], i, task, t);
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		pthread_join(tid[i], NULL);
+
+	pthread_barrier_destroy(&barrier);
+
+	/* Task info was written by other cores. */
+	dcache_invalidate();
+
+	/* The slowest thread gives the parallel time. */
+	for (int op = 0; op < NOPS; op++)
+	{
+		for (int it = 0; it < NITERATIONS; it++)
+		{
+			uint64_t slowest = 0;
+
+			for (int i = 0; i < nthreads; i++)
+			{
+				if (PERTHREAD_GET(tdata, i)->cycles[op][it] > slowest)
+					slowest = PERTHREAD_GET(tdata, i)->cycles[op][it];
+			}
+
+			benchmark_dump_stats(it, op, slowest);
+		}
+	}
+
+	footprint_dump("[benchmarks][stream]", nthreads);
+}
+
+/**
+ * @brief Memory Bandwidth Benchmark
+ */
+int main(int argc, char **argv)
+{
+	((void) argc);
+	((void) argv);
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][stream]");
+
+#ifndef NDEBUG
+
+	for (int size = ARRAY_SIZE_MIN; size <= ARRAY_SIZE_MAX; size *= 2)
+		kernel_stream(NTHREADS_MAX, size/sizeof(double));
+
+	affinity_dump("[benchmarks][stream]", NTHREADS_MAX);
+
+#else
+
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+	{
+		for (int size = ARRAY_SIZE_MIN; size <= ARRAY_SIZE_MAX; size *= 2)
+			kernel_stream(nthreads, size/sizeof(double));
+
+		affinity_dump("[benchmarks][stream]", nthreads);
+	}
+
+#endif
+
+	return (0);
+}
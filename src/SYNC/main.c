@@ -0,0 +1,426 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef __k1__
+#include <mppa/osconfig.h>
+#endif
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN               1  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX  (NUM_CORES - 1) /**< Maximum Number of Working Threads      */
+#define NTHREADS_STEP              1  /**< Increment on Number of Working Threads */
+#define NOPS                    1024  /**< Operations per Micro-Benchmark         */
+#define DIRTY_LINES               16  /**< Lines Written before an Invalidation   */
+/**@}*/
+
+/**
+ * @brief Task info.
+ */
+struct tdata
+{
+	int tnum;                                /**< Thread Number                     */
+	pthread_mutex_t lock;                    /**< Private Lock                      */
+	sem_t sem;                               /**< Semaphore of Ping-Pong            */
+	int counter;                             /**< Private Counter                   */
+	char dirty[DIRTY_LINES*CACHE_LINE_SIZE]; /**< Lines Dirtied before Invalidation */
+};
+
+/**
+ * @brief Task info of working threads.
+ */
+static PERTHREAD(struct tdata, tdata, NTHREADS_MAX);
+
+/**
+ * @name Shared Synchronization Objects
+ */
+/**@{*/
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; /**< Shared Lock            */
+static pthread_barrier_t barrier;                        /**< Barrier of All Threads */
+static volatile int counter ALIGN(CACHE_LINE_SIZE) = 0;  /**< Shared Counter         */
+/**@}*/
+
+/**
+ * @name Benchmark Kernel Parameters
+ */
+/**@{*/
+static int NTHREADS; /**< Number of Working Threads */
+/**@}*/
+
+/*============================================================================*
+ * Micro-Benchmarks                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Locks and unlocks a private mutex.
+ */
+static uint64_t sync_mutex_private(struct tdata *t)
+{
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+		{
+			pthread_mutex_lock(&t->lock);
+			pthread_mutex_unlock(&t->lock);
+		}
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Locks and unlocks a mutex shared by all threads.
+ */
+static uint64_t sync_mutex_shared(struct tdata *t)
+{
+	UNUSED(t);
+
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+		{
+			pthread_mutex_lock(&lock);
+			pthread_mutex_unlock(&lock);
+		}
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Bounces a token between pairs of threads. Each operation is
+ * a round trip, and a thread without a partner does not take part.
+ */
+static uint64_t sync_sem_pingpong(struct tdata *t)
+{
+	int partner = t->tnum ^ 1;
+
+	if (partner >= NTHREADS)
+		return (K1B_PERF_INVALID);
+
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+		{
+			if (t->tnum & 1)
+			{
+				sem_wait(&t->sem);
+				sem_post(&PERTHREAD_GET(tdata, partner)->sem);
+			}
+			else
+			{
+				sem_post(&PERTHREAD_GET(tdata, partner)->sem);
+				sem_wait(&t->sem);
+			}
+		}
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Waits on a barrier of all threads.
+ */
+static uint64_t sync_barrier(struct tdata *t)
+{
+	UNUSED(t);
+
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+			pthread_barrier_wait(&barrier);
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Atomically increments a private counter.
+ */
+static uint64_t sync_fetch_add_private(struct tdata *t)
+{
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+			__sync_fetch_and_add(&t->counter, 1);
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Atomically increments a counter shared by all threads.
+ */
+static uint64_t sync_fetch_add_shared(struct tdata *t)
+{
+	UNUSED(t);
+
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+			__sync_fetch_and_add(&counter, 1);
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Increments a counter shared by all threads with
+ * compare-and-swap. Failed attempts are retried with the value that
+ * was found, since cached copies of the counter may be stale.
+ */
+static uint64_t sync_cas_shared(struct tdata *t)
+{
+	int expected = 0;
+
+	UNUSED(t);
+
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+		{
+			int found;
+
+			while ((found = __sync_val_compare_and_swap(&counter, expected, expected + 1)) != expected)
+				expected = found;
+
+			expected++;
+		}
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Invalidates a clean data cache.
+ */
+static uint64_t sync_dcache_clean(struct tdata *t)
+{
+	UNUSED(t);
+
+	k1b_perf_start(0, K1B_PERF_CYCLES);
+
+		for (int i = 0; i < NOPS; i++)
+			dcache_invalidate();
+
+	k1b_perf_stop(0);
+
+	return (perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0)));
+}
+
+/**
+ * @brief Invalidates a data cache with DIRTY_LINES dirty lines. Only
+ * the invalidation is measured.
+ */
+static uint64_t sync_dcache_dirty(struct tdata *t)
+{
+	uint64_t cycles = 0;
+
+	for (int i = 0; i < NOPS; i++)
+	{
+		for (int j = 0; j < DIRTY_LINES; j++)
+			t->dirty[j*CACHE_LINE_SIZE] = i;
+
+		k1b_perf_start(0, K1B_PERF_CYCLES);
+
+			dcache_invalidate();
+
+		k1b_perf_stop(0);
+
+		cycles += perf_overhead_subtract(BENCHMARK_PERF_CYCLES, k1b_perf_read(0));
+	}
+
+	return (cycles);
+}
+
+/**
+ * @brief Micro-benchmark table.
+ *
+ * Micro-benchmarks return cycles without instrumentation overhead.
+ */
+static const struct ubench
+{
+	const char *name;                /**< Name            */
+	uint64_t (*fn)(struct tdata *);  /**< Micro-Benchmark */
+} ubenches[] = {
+	{ "mutex-private",     sync_mutex_private     },
+	{ "mutex-shared",      sync_mutex_shared      },
+	{ "sem-pingpong",      sync_sem_pingpong      },
+	{ "barrier",           sync_barrier           },
+	{ "fetch-add-private", sync_fetch_add_private },
+	{ "fetch-add-shared",  sync_fetch_add_shared  },
+	{ "cas-shared",        sync_cas_shared        },
+	{ "dcache-clean",      sync_dcache_clean      },
+	{ "dcache-dirty",      sync_dcache_dirty      },
+};
+
+/**
+ * @brief Number of micro-benchmarks.
+ */
+#define NUBENCHES ((int)(sizeof(ubenches)/sizeof(ubenches[0])))
+
+/**
+ * @brief Dump micro-benchmark statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param tnum   Thread number.
+ * @param u      Target micro-benchmark.
+ * @param cycles Cycles spent in the micro-benchmark, without
+ *               instrumentation overhead.
+ */
+static inline void benchmark_dump_stats(int it, int tnum, const struct ubench *u, uint64_t cycles)
+{
+#ifdef NDEBUG
+	printf("%s %d %d %d %s %d %llu %.3f\n",
+		"[benchmarks][sync]",
+		it,
+		NTHREADS,
+		tnum,
+		u->name,
+		NOPS,
+		UINT64(cycles),
+		DOUBLE(cycles)/NOPS
+	);
+#else
+	UNUSED(it);
+
+	printf("%s nthreads=%d tnum=%d    op=%-17s    cycles/op=%.3f\n",
+		"[benchmarks][sync]",
+		NTHREADS,
+		tnum,
+		u->name,
+		DOUBLE(cycles)/NOPS
+	);
+#endif
+}
+
+/*============================================================================*
+ * Kernel                                                                     *
+ *============================================================================*/
+
+/**
+ * @brief Runs all micro-benchmarks.
+ */
+static void *task(void *arg)
+{
+	struct tdata *t = arg;
+
+	for (int k = 0; k < NUBENCHES; k++)
+	{
+		const struct ubench *u = &ubenches[k];
+
+		for (int i = 0; i < (NITERATIONS + SKIP); i++)
+		{
+			uint64_t cycles;
+
+			/* Start all threads together. */
+			pthread_barrier_wait(&barrier);
+
+			cycles = u->fn(t);
+
+			if ((i >= SKIP) && (cycles != K1B_PERF_INVALID))
+				benchmark_dump_stats(i - SKIP, t->tnum, u, cycles);
+		}
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Synchronization Benchmark Kernel
+ *
+ * @param nthreads Number of working threads.
+ */
+static void kernel_sync(int nthreads)
+{
+	pthread_t tid[NTHREADS_MAX];
+
+	/* Save kernel parameters. */
+	NTHREADS = nthreads;
+
+	pthread_barrier_init(&barrier, NULL, nthreads);
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		struct tdata *t = PERTHREAD_GET(tdata, i);
+
+		/* Initialize thread data structure. */
+		t->tnum = i;
+		t->counter = 0;
+		pthread_mutex_init(&t->lock, NULL);
+		sem_init(&t->sem, 0, 0);
+
+		affinity_thread_create(&tid[i], i, task, t);
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		pthread_join(tid[i], NULL);
+
+	/* House keeping. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		pthread_mutex_destroy(&PERTHREAD_GET(tdata, i)->lock);
+		sem_destroy(&PERTHREAD_GET(tdata, i)->sem);
+	}
+
+	pthread_barrier_destroy(&barrier);
+
+	affinity_dump("[benchmarks][sync]", nthreads);
+	footprint_dump("[benchmarks][sync]", nthreads);
+}
+
+/**
+ * @brief Synchronization Benchmark
+ */
+int main(int argc, char **argv)
+{
+	((void) argc);
+	((void) argv);
+
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][sync]");
+
+#ifndef NDEBUG
+
+	kernel_sync(NTHREADS_MAX);
+
+#else
+
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+		kernel_sync(nthreads);
+
+#endif
+
+	return (0);
+}
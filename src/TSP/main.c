@@ -15,7 +15,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef __k1__
 #include <mppa/osconfig.h>
+#endif
 #include <assert.h>
 #include <limits.h>
 #include <pthread.h>
@@ -49,12 +51,107 @@
 /**@{*/
 #define MAX_GRID_X		                                   100   /**< Maximum of Lines on Grid            */
 #define MAX_GRID_Y		                                   100   /**< Maximum of Columns on Grid          */
-#define INITIAL_JOB_DIST                                    50.0 /**< Initial Job Distribution Percentage */
+#define INITIAL_JOB_DIST                                    50   /**< Initial Job Distribution Percentage */
 #define MIN_JOBS_PER_THREAD                                 20   /**< Minimum Jobs Per Thread             */
 #define MAX_JOBS_PER_THREAD                                150   /**< Maximum Jobs per Thread             */
 #define MAX_JOBS_PER_QUEUE  (MAX_JOBS_PER_THREAD * NTHREADS_MAX) /**< Maximum of Jobs Per Thread          */
 /**@}*/
 
+/*============================================================================*
+ * Data Layout                                                                *
+ *============================================================================*/
+
+/*
+ * The layout of the distance matrix and of the jobs is selected at
+ * build time, so that cache and memcpy() costs of each one can be
+ * compared against the default layout:
+ *
+ * - TSP_SOA:     distance matrix as a structure of arrays.
+ * - TSP_COMPACT: narrow types for cities and distances, and jobs
+ *                padded to a power of two that fits in a cache line.
+ */
+
+#ifdef TSP_COMPACT
+
+	#if (NTOWNS > 62)
+		#error "too many towns for compact layout"
+	#endif
+
+	/**
+	 * @brief City.
+	 */
+	typedef uint8_t city_t;
+
+	/**
+	 * @brief Distance.
+	 */
+	typedef uint16_t dist_t;
+
+	/**
+	 * @brief Alignment of a job.
+	 */
+	#if (NTOWNS <= 14)
+		#define JOB_ALIGN 16
+	#elif (NTOWNS <= 30)
+		#define JOB_ALIGN 32
+	#else
+		#define JOB_ALIGN CACHE_LINE_SIZE
+	#endif
+
+#else
+
+	/**
+	 * @brief City.
+	 */
+	typedef int city_t;
+
+	/**
+	 * @brief Distance.
+	 */
+	typedef int dist_t;
+
+	/**
+	 * @brief Alignment of a job.
+	 */
+	#define JOB_ALIGN sizeof(int)
+
+#endif
+
+/**
+ * @brief Name of the data layout.
+ */
+#if defined(TSP_SOA) && defined(TSP_COMPACT)
+	#define TSP_LAYOUT "soa-compact"
+#elif defined(TSP_SOA)
+	#define TSP_LAYOUT "soa"
+#elif defined(TSP_COMPACT)
+	#define TSP_LAYOUT "aos-compact"
+#else
+	#define TSP_LAYOUT "aos"
+#endif
+
+/**
+ * @name Profiling Regions
+ */
+/**@{*/
+#define REGION_DEQUEUE    0 /**< Dequeue a Job        */
+#define REGION_REPOPULATE 1 /**< Repopulate the Queue */
+#define REGION_SEARCH     2 /**< Search a Job         */
+#define REGION_BOUND      3 /**< Read/Update Bound    */
+/**@}*/
+
+/**
+ * @name Trace Events
+ */
+/**@{*/
+#define TRACE_WORKER     0 /**< Lifetime of a Worker */
+#define TRACE_SEARCH     1 /**< Search a Job         */
+#define TRACE_REPOPULATE 2 /**< Repopulate the Queue */
+#define TRACE_LOCK_WAIT  3 /**< Wait for Queue Lock  */
+#define TRACE_LOCK_HOLD  4 /**< Hold Queue Lock      */
+#define TRACE_QUEUE_WAIT 5 /**< Wait for Jobs        */
+/**@}*/
+
 /**
  * @brief Current performance event being monitored.
  */
@@ -67,6 +164,17 @@ static int perf;
 static int NTHREADS;    /**< Number of Working Threads. */
 /**@}*/
 
+/**
+ * @name Partitioning Parameters
+ *
+ * Defaults may be overridden by the tuning file.
+ */
+/**@{*/
+static int npartitions = NPARTITIONS;                 /**< Partitions Per Cluster               */
+static int initial_job_dist = INITIAL_JOB_DIST;       /**< Initial Job Distribution Percentage  */
+static int min_jobs_per_thread = MIN_JOBS_PER_THREAD; /**< Minimum Jobs Per Thread              */
+/**@}*/
+
 /**
  * @name Benchmark Kernel Variables
  */
@@ -85,7 +193,18 @@ static pthread_mutex_t main_lock; /**< Lock for Kernel Variables.           */
 static int waiting_threads = 0;   /**< Number of threads waiting the queue. */
 /**@}*/
 
-static uint64_t stats[NTHREADS_MAX][BENCHMARK_PERF_EVENTS] ALIGN(CACHE_LINE_SIZE);
+/**
+ * @brief Performance events of a thread.
+ */
+struct tstats
+{
+	uint64_t events[BENCHMARK_PERF_EVENTS]; /**< Performance Events */
+};
+
+/**
+ * @brief Performance events of working threads.
+ */
+static PERTHREAD(struct tstats, stats, NTHREADS_MAX);
 
 /*----------------------------------------------------------------------------*
  * benchmark_dump_stats()                                                     *
@@ -100,38 +219,41 @@ static uint64_t stats[NTHREADS_MAX][BENCHMARK_PERF_EVENTS] ALIGN(CACHE_LINE_SIZE
  */
 static void benchmark_dump_stats(int it, int ntowns, uint64_t *st)
 {
+	uint64_t corrected[BENCHMARK_PERF_EVENTS];
+
+	perf_stats_check("[benchmarks][tsp]", it, NTHREADS, st);
+	perf_overhead_correct(corrected, st);
+
 #ifdef NDEBUG
-	printf("%s %d %d %d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+	char buf_raw[PERF_STATS_STRLEN];
+	char buf_corrected[PERF_STATS_STRLEN];
+
+	perf_stats_format(buf_raw, sizeof(buf_raw), st);
+	perf_stats_format(buf_corrected, sizeof(buf_corrected), corrected);
+
+	printf("%s %d %d %d %s %s\n",
 		"[benchmarks][tsp]",
 		it,
 		NTHREADS,
 		ntowns,
-		UINT32(st[0]),
-		UINT32(st[1]),
-		UINT32(st[2]),
-		UINT32(st[3]),
-		UINT32(st[4]),
-		UINT32(st[5]),
-		UINT32(st[6]),
-		UINT32(st[7]),
-		UINT32(st[8]),
-		UINT32(st[9]),
-		UINT32(st[10]),
-		UINT32(st[11]),
-		UINT32(st[12]),
-		UINT32(st[13])
+		buf_raw,
+		buf_corrected
 	);
 #else
 	UNUSED(it);
 
-	printf("%s nthreads=%d    ntowns=%d    min_distance=%d    time=%.2f us\n",
+	printf("%s nthreads=%d    ntowns=%d    layout=%s    min_distance=%d    time=%.2f us (%.2f us corrected)\n",
 		"[benchmarks][tsp]",
 		NTHREADS,
 		ntowns,
+		TSP_LAYOUT,
 		min_distance,
-		(UINT32(st[0])/FLOAT(CLUSTER_FREQ))
+		CYCLES_TO_USECONDS(st[0]),
+		CYCLES_TO_USECONDS(corrected[0])
 	);
 #endif
+
+	perf_metrics_dump("[benchmarks][tsp]", it, NTHREADS, corrected);
 }
 
 /*============================================================================*
@@ -144,11 +266,39 @@ struct partition_interval
 	int end;
 };
 
+#ifdef TSP_SOA
+
 static struct distance_matrix
 {
-	int to_city;
-	int dist;
-} distance[NTOWNS][NTOWNS];
+	city_t to_city[NTOWNS][NTOWNS];
+	dist_t dist[NTOWNS][NTOWNS];
+} distance ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @name Indexes the distance matrix.
+ */
+/**@{*/
+#define DISTANCE_TO_CITY(i, j) distance.to_city[(i)][(j)]
+#define DISTANCE_DIST(i, j)    distance.dist[(i)][(j)]
+/**@}*/
+
+#else
+
+static struct distance_matrix
+{
+	city_t to_city;
+	dist_t dist;
+} distance[NTOWNS][NTOWNS] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @name Indexes the distance matrix.
+ */
+/**@{*/
+#define DISTANCE_TO_CITY(i, j) distance[(i)][(j)].to_city
+#define DISTANCE_DIST(i, j)    distance[(i)][(j)].dist
+/**@}*/
+
+#endif
 
 static struct jobs_queue
 {
@@ -168,9 +318,9 @@ static struct jobs_queue
 
 	struct job
 	{
-		int lenght;
-		int path[NTOWNS];
-	} jobs[MAX_JOBS_PER_QUEUE];
+		dist_t lenght;
+		city_t path[NTOWNS];
+	} ALIGN(JOB_ALIGN) *jobs;
 } queue;
 
 /*----------------------------------------------------------------------------*
@@ -183,17 +333,48 @@ static void reset_queue(void)
 	queue.end   = 0;
 }
 
+/*----------------------------------------------------------------------------*
+ * lock_queue()                                                               *
+ *----------------------------------------------------------------------------*/
+
+static inline void lock_queue(void)
+{
+	TRACE_BEGIN(TRACE_LOCK_WAIT);
+	pthread_mutex_lock(&queue.lock);
+	TRACE_END(TRACE_LOCK_WAIT);
+
+	TRACE_BEGIN(TRACE_LOCK_HOLD);
+}
+
+/*----------------------------------------------------------------------------*
+ * unlock_queue()                                                             *
+ *----------------------------------------------------------------------------*/
+
+static inline void unlock_queue(void)
+{
+	TRACE_END(TRACE_LOCK_HOLD);
+
+	pthread_mutex_unlock(&queue.lock);
+}
+
 /*----------------------------------------------------------------------------*
  * init_queue()                                                               *
  *----------------------------------------------------------------------------*/
 
-void init_queue(int queue_size)
+int init_queue(int queue_size)
 {
 	queue.begin    = 0;
 	queue.end      = 0;
 	queue.status   = EMPTY_QUEUE;
 	queue.max_size = queue_size;
 
+	arena_reset();
+	if ((queue.jobs = arena_alloc(sizeof(struct job) * queue_size)) == NULL)
+	{
+		arena_dump("[benchmarks][tsp]");
+		return (-1);
+	}
+
 	sem_init(&queue.semaphore, 0, 0);
 
 	pthread_mutex_init(&queue.lock, NULL);
@@ -201,6 +382,8 @@ void init_queue(int queue_size)
 	memset(&queue.jobs[0], 0, sizeof(struct job) * queue_size);
 
 	waiting_threads = 0;
+
+	return (0);
 }
 
 /*----------------------------------------------------------------------------*
@@ -225,7 +408,7 @@ static void close_queue(void)
 
 static void enqueue(struct job *job)
 {
-	pthread_mutex_lock(&queue.lock);
+	lock_queue();
 
 		assert(queue.end < queue.max_size);
 
@@ -235,7 +418,7 @@ static void enqueue(struct job *job)
 
 		sem_post(&queue.semaphore);
 
-	pthread_mutex_unlock(&queue.lock);
+	unlock_queue();
 }
 
 /*----------------------------------------------------------------------------*
@@ -249,7 +432,7 @@ static int dequeue(struct job * job)
 	int index;
 	int jobs_added;
 
-	pthread_mutex_lock(&queue.lock);
+	lock_queue();
 
 		dcache_invalidate();
 
@@ -258,11 +441,11 @@ static int dequeue(struct job * job)
 			switch (queue.status)
 			{
 				case CLOSED_QUEUE:
-					pthread_mutex_unlock(&queue.lock);
+					unlock_queue();
 					return (0);
 
 				case WAIT_QUEUE:
-					pthread_mutex_unlock(&queue.lock);
+					unlock_queue();
 
 						pthread_mutex_lock(&main_lock);
 						dcache_invalidate();
@@ -272,7 +455,9 @@ static int dequeue(struct job * job)
 						dcache_invalidate();
 						pthread_mutex_unlock(&main_lock);
 
+						TRACE_BEGIN(TRACE_QUEUE_WAIT);
 						sem_wait(&queue.semaphore);
+						TRACE_END(TRACE_QUEUE_WAIT);
 
 						pthread_mutex_lock(&main_lock);
 						dcache_invalidate();
@@ -282,18 +467,22 @@ static int dequeue(struct job * job)
 						dcache_invalidate();
 						pthread_mutex_unlock(&main_lock);
 
-					pthread_mutex_lock(&queue.lock);
+					lock_queue();
 					break;
 
 				case EMPTY_QUEUE:
 					queue.status = WAIT_QUEUE;
 					reset_queue();
 
-					pthread_mutex_unlock(&queue.lock);
+					unlock_queue();
 
+						TRACE_BEGIN(TRACE_REPOPULATE);
+						K1B_PERF_REGION_BEGIN(REGION_REPOPULATE);
 						jobs_added = repopulate_queue();
+						K1B_PERF_REGION_END(REGION_REPOPULATE);
+						TRACE_END(TRACE_REPOPULATE);
 
-					pthread_mutex_lock(&queue.lock);
+					lock_queue();
 
 					if (jobs_added)
 						queue.status = EMPTY_QUEUE;
@@ -315,7 +504,7 @@ static int dequeue(struct job * job)
 
 		dcache_invalidate();
 
-	pthread_mutex_unlock(&queue.lock);
+	unlock_queue();
 
 	return (1);
 }
@@ -324,7 +513,7 @@ static int dequeue(struct job * job)
  * TSP functions                                                              *
  *============================================================================*/
 
-static inline int present(int city, int hops, int *path)
+static inline int present(int city, int hops, city_t *path)
 {
 	for (int i = 0; i < hops; i++)
 	{
@@ -346,11 +535,11 @@ static void get_next_partition(struct partition_interval * partition)
 	int block_size;
 
 	alfa = 1;
-	block_size = NPARTITIONS / (1.0 / (INITIAL_JOB_DIST / 100.0));
+	block_size = (npartitions*initial_job_dist)/100;
 
 	if (processed_partitions != 0)
 	{
-		block_size2 = (NPARTITIONS - next_partition_id) / alfa;
+		block_size2 = (npartitions - next_partition_id) / alfa;
 		block_size = (block_size2 < block_size) ? block_size2 : block_size;
 	}
 
@@ -359,13 +548,13 @@ static void get_next_partition(struct partition_interval * partition)
 
 	partition->start = partition->end = -1;
 
-	if (next_partition_id < NPARTITIONS)
+	if (next_partition_id < npartitions)
 		partition->start = next_partition_id;
 
-	if (next_partition_id + block_size - 1 < NPARTITIONS)
+	if (next_partition_id + block_size - 1 < npartitions)
 		partition->end = next_partition_id + block_size - 1;
 	else
-		partition->end = partition->start + NPARTITIONS - partition->start;
+		partition->end = partition->start + npartitions - partition->start;
 
 	next_partition_id += block_size;
 }
@@ -378,7 +567,7 @@ static void distributor(
 	struct partition_interval *partition,
 	int hops,
 	int lenght,
-	int *path,
+	city_t *path,
 	int *jobs_count
 )
 {
@@ -391,7 +580,7 @@ static void distributor(
 	/* End recursion */
 	if (hops == max_hops)
 	{
-		job_id = (*jobs_count) % NPARTITIONS;
+		job_id = (*jobs_count) % npartitions;
 
 		if ((job_id >= partition->start) && (job_id <= partition->end))
 		{
@@ -413,12 +602,12 @@ static void distributor(
 
 		for (int i = 0; i < NTOWNS; i++)
 		{
-			city = distance[me][i].to_city;
+			city = DISTANCE_TO_CITY(me, i);
 
 			if (!present(city, hops, path))
 			{
 				path[hops] = city;
-				dist = distance[me][i].dist;
+				dist = DISTANCE_DIST(me, i);
 
 				distributor(partition, (hops + 1), (lenght + dist), path, jobs_count);
 			}
@@ -433,7 +622,7 @@ static void distributor(
 static int repopulate_queue(void)
 {
 	int jobs_count;
-	int path[NTOWNS];
+	city_t path[NTOWNS];
 	struct partition_interval partition;
 
 	get_next_partition(&partition);
@@ -461,6 +650,8 @@ static int get_shortest_lenght(void)
 {
 	int dist;
 
+	K1B_PERF_REGION_BEGIN(REGION_BOUND);
+
 	pthread_mutex_lock(&main_lock);
 	dcache_invalidate();
 
@@ -469,6 +660,8 @@ static int get_shortest_lenght(void)
 	dcache_invalidate();
 	pthread_mutex_unlock(&main_lock);
 
+	K1B_PERF_REGION_END(REGION_BOUND);
+
 	return (dist);
 }
 
@@ -483,6 +676,8 @@ static int update_minimum_distance(int new_distance)
 
 	updated = 0;
 
+	K1B_PERF_REGION_BEGIN(REGION_BOUND);
+
 	pthread_mutex_lock(&main_lock);
 	dcache_invalidate();
 
@@ -498,6 +693,8 @@ static int update_minimum_distance(int new_distance)
 
 	pthread_mutex_unlock(&main_lock);
 
+	K1B_PERF_REGION_END(REGION_BOUND);
+
 	return (updated);
 }
 
@@ -505,7 +702,7 @@ static int update_minimum_distance(int new_distance)
  * execute_tsp()                                                              *
  *----------------------------------------------------------------------------*/
 
-static void execute_tsp(int hops, int lenght, int *path)
+static void execute_tsp(int hops, int lenght, city_t *path)
 {
 	int me;
 	int city;
@@ -525,12 +722,12 @@ static void execute_tsp(int hops, int lenght, int *path)
 
 		for (int i = 0; i < NTOWNS; i++)
 		{
-			city = distance[me][i].to_city;
+			city = DISTANCE_TO_CITY(me, i);
 
 			if (!present(city, hops, path))
 			{
 				path[hops] = city;
-				dist = distance[me][i].dist;
+				dist = DISTANCE_DIST(me, i);
 				execute_tsp((hops + 1), (lenght + dist), path);
 			}
 		}
@@ -548,24 +745,36 @@ static void *worker(void *arg)
 {
 	int found;
 	struct job job;
-	int tid = ((int) arg);
+	int tid = (int) ((intptr_t) arg);
 
 	dcache_invalidate();
 
+	K1B_PERF_REGION_SETUP(K1B_PERF_CYCLES);
+
+	TRACE_BEGIN(TRACE_WORKER);
+
 	k1b_perf_start(0, k1b_perf_events[perf]);
 
 		while (1)
 		{
+			K1B_PERF_REGION_BEGIN(REGION_DEQUEUE);
 			found = dequeue(&job);
+			K1B_PERF_REGION_END(REGION_DEQUEUE);
 
 			if (!found)
 				break;
 
+			TRACE_BEGIN(TRACE_SEARCH);
+			K1B_PERF_REGION_BEGIN(REGION_SEARCH);
 			execute_tsp(max_hops, job.lenght, job.path);
+			K1B_PERF_REGION_END(REGION_SEARCH);
+			TRACE_END(TRACE_SEARCH);
 		}
 
 	k1b_perf_stop(0);
-	stats[tid][perf] = k1b_perf_read(0);
+	PERTHREAD_GET(stats, tid)->events[perf] = k1b_perf_read(0);
+
+	TRACE_END(TRACE_WORKER);
 
 	dcache_invalidate();
 
@@ -617,8 +826,8 @@ static void init_distance(void)
 			}
 
 			tempdist[city] = INT_MAX;
-			distance[i][j].to_city = city;
-			distance[i][j].dist    = tmp;
+			DISTANCE_TO_CITY(i, j) = city;
+			DISTANCE_DIST(i, j)    = tmp;
 		}
 	}
 }
@@ -636,7 +845,7 @@ static int init_max_hops(void)
 	new_total = 1;
 	max_hops = 0;
 
-	while ((new_total < (MIN_JOBS_PER_THREAD * NTHREADS)) && (max_hops < (NTOWNS - 1)))
+	while ((new_total < (min_jobs_per_thread * NTHREADS)) && (max_hops < (NTOWNS - 1)))
 	{
 		max_hops++;
 		total = new_total;
@@ -650,14 +859,12 @@ static int init_max_hops(void)
  * init_tsp()                                                                 *
  *----------------------------------------------------------------------------*/
 
-static void init_tsp(int nthreads, int ntowns)
+static int init_tsp(int nthreads, int ntowns)
 {
 	int qsize;
 
 	((void) ntowns);
 
-	pthread_mutex_init(&main_lock, NULL);
-
 	NTHREADS     = nthreads;
 	min_distance = INT_MAX;
 	next_partition_id = 0;
@@ -668,9 +875,14 @@ static void init_tsp(int nthreads, int ntowns)
 	qsize = init_max_hops();
 	qsize = qsize + qsize;
 
-	init_queue(qsize);
+	if (init_queue(qsize) < 0)
+		return (-1);
+
+	pthread_mutex_init(&main_lock, NULL);
 
 	dcache_invalidate();
+
+	return (0);
 }
 
 /*----------------------------------------------------------------------------*
@@ -686,6 +898,115 @@ static void finish_tsp(void)
 	pthread_mutex_destroy(&main_lock);
 }
 
+#ifdef OPENMP
+
+/*============================================================================*
+ * OpenMP                                                                     *
+ *============================================================================*/
+
+/**
+ * @brief Spawns a task for each path of max_hops towns.
+ */
+static void spawn_tasks(int hops, int lenght, city_t *path)
+{
+	/* End recursion. */
+	if (hops == max_hops)
+	{
+		struct job job;
+
+		job.lenght = lenght;
+		for (int i = 0; i < hops; i++)
+			job.path[i] = path[i];
+
+		#pragma omp task firstprivate(job)
+		execute_tsp(max_hops, job.lenght, job.path);
+	}
+
+	/* Go down. */
+	else
+	{
+		int me = path[hops - 1];
+
+		for (int i = 0; i < NTOWNS; i++)
+		{
+			int city = DISTANCE_TO_CITY(me, i);
+
+			if (!present(city, hops, path))
+			{
+				path[hops] = city;
+				spawn_tasks(hops + 1, lenght + DISTANCE_DIST(me, i), path);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Compares the Travelling Salesman Kernel against its OpenMP
+ * Variant
+ *
+ * Paths that seed tasks are as long as jobs of the queue, and tasks
+ * replace the queue and its partitioning.
+ *
+ * @param nthreads Number of working threads.
+ * @param ntowns   Number of towns.
+ */
+static int kernel_tsp_openmp(int nthreads, int ntowns)
+{
+	uint64_t best[OPENMP_NVARIANTS] = { UINT64_MAX, UINT64_MAX };
+
+	perf = BENCHMARK_PERF_CYCLES;
+
+	openmp_bind(nthreads);
+
+	for (int k = 0; k < (NITERATIONS + SKIP); k++)
+	{
+		for (int pass = 0; pass < OPENMP_NVARIANTS; pass++)
+		{
+			int variant = OPENMP_VARIANT(k, pass);
+			pthread_t tid[NTHREADS_MAX];
+			uint64_t start;
+			uint64_t end;
+
+			if (init_tsp(nthreads, ntowns) < 0)
+				return (-1);
+
+			start = k1b_perf_timestamp();
+
+			if (variant == OPENMP_PTHREADS)
+			{
+				for (int i = 0; i < nthreads; i++)
+					affinity_thread_create(&tid[i], i, worker, (void *) ((intptr_t) i));
+				for (int i = 0; i < nthreads; i++)
+					pthread_join(tid[i], NULL);
+			}
+			else
+			{
+				#pragma omp parallel num_threads(nthreads)
+				#pragma omp single
+				{
+					city_t path[NTOWNS];
+
+					path[0] = 0;
+					spawn_tasks(1, 0, path);
+				}
+			}
+
+			end = k1b_perf_timestamp();
+
+			finish_tsp();
+
+			if ((k >= SKIP) && (end - start < best[variant]))
+				best[variant] = end - start;
+		}
+	}
+
+	openmp_dump("[benchmarks][tsp]", nthreads, best[OPENMP_PTHREADS], best[OPENMP_OPENMP]);
+
+	return (0);
+}
+
+#endif
+
 /*============================================================================*
  * kernel_tsp()                                                               *
  *============================================================================*/
@@ -695,9 +1016,24 @@ static void finish_tsp(void)
  *
  * @param nthreads Number of working threads.
  * @param ntowns   Number of towns.
+ *
+ * @returns Zero if the kernel runs, and a negative number if the job
+ * queue does not fit in the arena.
  */
-static void kernel_tsp(int nthreads, int ntowns)
+static int kernel_tsp(int nthreads, int ntowns)
 {
+	K1B_PERF_REGION_NAME(REGION_DEQUEUE, "dequeue");
+	K1B_PERF_REGION_NAME(REGION_REPOPULATE, "repopulate");
+	K1B_PERF_REGION_NAME(REGION_SEARCH, "search");
+	K1B_PERF_REGION_NAME(REGION_BOUND, "bound");
+
+	TRACE_NAME(TRACE_WORKER, "worker");
+	TRACE_NAME(TRACE_SEARCH, "search");
+	TRACE_NAME(TRACE_REPOPULATE, "repopulate");
+	TRACE_NAME(TRACE_LOCK_WAIT, "lock-wait");
+	TRACE_NAME(TRACE_LOCK_HOLD, "lock-hold");
+	TRACE_NAME(TRACE_QUEUE_WAIT, "queue-wait");
+
 	for (int k = 0; k < (NITERATIONS + SKIP); k++)
 	{
 		for (perf = 0; perf < BENCHMARK_PERF_EVENTS; perf++)
@@ -705,11 +1041,15 @@ static void kernel_tsp(int nthreads, int ntowns)
 			pthread_t tid[NTHREADS_MAX];
 
 			/* Save kernel parameters. */
-			init_tsp(nthreads, ntowns);
+			if (init_tsp(nthreads, ntowns) < 0)
+				return (-1);
+
+			/* Keep trace of the last run only. */
+			TRACE_CLEAR();
 
 			/* Spawn threads. */
 			for (int i = 0; i < nthreads; i++)
-				pthread_create(&tid[i], NULL, worker, (void *) i);
+				affinity_thread_create(&tid[i], i, worker, (void *) ((intptr_t) i));
 
 			/* Wait for threads. */
 			for (int i = 0; i < nthreads; i++)
@@ -723,9 +1063,118 @@ static void kernel_tsp(int nthreads, int ntowns)
 		if (k >= SKIP)
 		{
 			for (int i = 0; i < nthreads; i++)
-				benchmark_dump_stats(k - SKIP, ntowns, &stats[i][0]);
+			{
+				benchmark_dump_stats(k - SKIP, ntowns, PERTHREAD_GET(stats, i)->events);
+				scaling_sample(i, k - SKIP, PERTHREAD_GET(stats, i)->events[BENCHMARK_PERF_CYCLES]);
+			}
+
+			PERF_REGIONS_DUMP("[benchmarks][tsp]", k - SKIP, nthreads);
+			TRACE_DUMP("[benchmarks][tsp]", k - SKIP, nthreads);
 		}
 	}
+
+	scaling_record(nthreads);
+	affinity_dump("[benchmarks][tsp]", nthreads);
+	footprint_dump("[benchmarks][tsp]", nthreads);
+
+#ifdef OPENMP
+	return (kernel_tsp_openmp(nthreads, ntowns));
+#else
+	return (0);
+#endif
+}
+
+#ifdef TUNE
+
+/*============================================================================*
+ * Tuning                                                                     *
+ *============================================================================*/
+
+/**
+ * @brief Number of runs of each configuration.
+ */
+#define TUNE_NRUNS 3
+
+/**
+ * @brief Searched parameters.
+ */
+static struct tune_param params[] = {
+	{ "npartitions",          4, 64,  4, 0 },
+	{ "min_jobs_per_thread",  5, 60,  5, 0 },
+	{ "initial_job_dist",    10, 90, 10, 0 },
+};
+
+/**
+ * @brief Runs the kernel with a configuration.
+ *
+ * @returns The fastest run (in cycles), or UINT64_MAX if the kernel
+ * does not run.
+ */
+static uint64_t evaluate(int nthreads, const struct tune_param *p, int nparams)
+{
+	uint64_t best = UINT64_MAX;
+
+	((void) nparams);
+
+	npartitions = p[0].value;
+	min_jobs_per_thread = p[1].value;
+	initial_job_dist = p[2].value;
+
+	perf = BENCHMARK_PERF_CYCLES;
+
+	for (int k = 0; k < TUNE_NRUNS; k++)
+	{
+		pthread_t tid[NTHREADS_MAX];
+		uint64_t start;
+		uint64_t end;
+
+		if (init_tsp(nthreads, NTOWNS) < 0)
+			return (UINT64_MAX);
+
+		start = k1b_perf_timestamp();
+
+			for (int i = 0; i < nthreads; i++)
+				affinity_thread_create(&tid[i], i, worker, (void *) ((intptr_t) i));
+			for (int i = 0; i < nthreads; i++)
+				pthread_join(tid[i], NULL);
+
+		end = k1b_perf_timestamp();
+
+		finish_tsp();
+
+		if (end - start < best)
+			best = end - start;
+	}
+
+	return (best);
+}
+
+#endif
+
+/**
+ * @brief Runs the kernel with the partitioning parameters of a number
+ * of threads, which are searched in TUNE builds and loaded from the
+ * tuning file otherwise.
+ *
+ * @param nthreads Number of working threads.
+ *
+ * @returns Zero if the kernel runs, and a negative number otherwise.
+ */
+static int benchmark_tsp(int nthreads)
+{
+#ifdef TUNE
+	tune_search("[benchmarks][tsp]", NTOWNS, nthreads, params, sizeof(params)/sizeof(params[0]), evaluate);
+
+	npartitions = params[0].value;
+	min_jobs_per_thread = params[1].value;
+	initial_job_dist = params[2].value;
+#else
+	npartitions = tune_get("tsp", NTOWNS, nthreads, "npartitions", NPARTITIONS);
+	min_jobs_per_thread = tune_get("tsp", NTOWNS, nthreads, "min_jobs_per_thread", MIN_JOBS_PER_THREAD);
+	initial_job_dist = tune_get("tsp", NTOWNS, nthreads, "initial_job_dist", INITIAL_JOB_DIST);
+#endif
+
+	return (kernel_tsp(nthreads, NTOWNS));
 }
 
 /**
@@ -736,14 +1185,23 @@ int main(int argc, char **argv)
 	((void) argc);
 	((void) argv);
 
+	perf_overhead_calibrate();
+	perf_overhead_dump("[benchmarks][tsp]");
+
 #ifndef NDEBUG
 
-	kernel_tsp(NTHREADS_MAX, NTOWNS);
+	if (benchmark_tsp(NTHREADS_MAX) < 0)
+		return (-1);
 
 #else
 
 	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
-		kernel_tsp(nthreads, NTOWNS);
+	{
+		if (benchmark_tsp(nthreads) < 0)
+			return (-1);
+	}
+
+	scaling_dump("[benchmarks][tsp]");
 
 #endif
 
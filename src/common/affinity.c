@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * On the MPPA-256, NodeOS runs each thread on a core of its own and
+ * offers no way to choose which one, thus placement is only recorded.
+ * On Linux hosts, threads are pinned to CPUs of the process affinity
+ * mask, ordered by NUMA node, package, core and SMT sibling.
+ */
+
+#ifndef __k1__
+	#define _GNU_SOURCE
+	#include <sched.h>
+	#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Maximum number of CPUs considered on Linux hosts.
+ */
+#define AFFINITY_CPUS_MAX 1024
+
+/**
+ * @brief Maximum number of NUMA nodes probed on Linux hosts.
+ */
+#define AFFINITY_NODES_MAX 64
+
+/**
+ * @brief Names of placement policies.
+ */
+static const char *policies[] = { "none", "compact", "scatter", "list" };
+
+/**
+ * @brief Placement of a working thread.
+ */
+struct affinity_slot
+{
+	void *(*fn)(void *); /**< Start Routine      */
+	void *arg;           /**< Argument           */
+	int requested;       /**< CPU Requested      */
+	int actual;          /**< CPU Actually Used  */
+} ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Placement of working threads.
+ */
+static struct affinity_slot slots[NUM_CORES];
+
+#ifndef __k1__
+
+/**
+ * @brief Location of a CPU in the topology of the host.
+ */
+struct affinity_cpu
+{
+	int cpu;     /**< CPU Number                  */
+	int node;    /**< NUMA Node                   */
+	int package; /**< Physical Package            */
+	int core;    /**< Core in the Package         */
+	int sibling; /**< SMT Sibling in the Core     */
+	int rank;    /**< Core in the NUMA Node       */
+};
+
+/**
+ * @brief CPUs in the order of the placement policy.
+ */
+static int order[AFFINITY_CPUS_MAX];
+
+/**
+ * @brief Number of CPUs in @p order.
+ */
+static int ncpus = 0;
+
+/**
+ * @brief Reads an integer from a sysfs file.
+ *
+ * @param path Path to the file.
+ *
+ * @returns The integer that was read, or zero on failure.
+ */
+static int affinity_sysfs_read(const char *path)
+{
+	int x = 0;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL)
+		return (0);
+
+	if (fscanf(fp, "%d", &x) != 1)
+		x = 0;
+
+	fclose(fp);
+
+	return (x);
+}
+
+/**
+ * @brief Probes the location of a CPU.
+ *
+ * @param c Store location for the CPU.
+ */
+static void affinity_probe(struct affinity_cpu *c)
+{
+	char path[128];
+
+	sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c->cpu);
+	c->package = affinity_sysfs_read(path);
+	sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/core_id", c->cpu);
+	c->core = affinity_sysfs_read(path);
+
+	c->node = 0;
+	for (int n = 0; n < AFFINITY_NODES_MAX; n++)
+	{
+		sprintf(path, "/sys/devices/system/cpu/cpu%d/node%d", c->cpu, n);
+
+		if (access(path, F_OK) == 0)
+		{
+			c->node = n;
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Compares CPUs in compact order: SMT siblings first, then
+ * cores of a package, then packages of a NUMA node.
+ */
+static int affinity_cmp_compact(const void *p1, const void *p2)
+{
+	const struct affinity_cpu *a = p1;
+	const struct affinity_cpu *b = p2;
+
+	if (a->node != b->node)
+		return (a->node - b->node);
+	if (a->package != b->package)
+		return (a->package - b->package);
+	if (a->core != b->core)
+		return (a->core - b->core);
+
+	return (a->cpu - b->cpu);
+}
+
+/**
+ * @brief Compares CPUs in scatter order: NUMA nodes first, then
+ * cores, and SMT siblings only when all cores are taken.
+ */
+static int affinity_cmp_scatter(const void *p1, const void *p2)
+{
+	const struct affinity_cpu *a = p1;
+	const struct affinity_cpu *b = p2;
+
+	if (a->sibling != b->sibling)
+		return (a->sibling - b->sibling);
+	if (a->rank != b->rank)
+		return (a->rank - b->rank);
+	if (a->node != b->node)
+		return (a->node - b->node);
+
+	return (a->cpu - b->cpu);
+}
+
+/**
+ * @brief Orders CPUs of the process according to the placement policy.
+ */
+static void affinity_init(void)
+{
+#if (AFFINITY_POLICY == AFFINITY_LIST)
+	const char *p = AFFINITY_CPUS;
+#else
+	cpu_set_t set;
+	static struct affinity_cpu cpus[AFFINITY_CPUS_MAX];
+#endif
+
+	if (ncpus > 0)
+		return;
+
+#if (AFFINITY_POLICY == AFFINITY_LIST)
+
+	/* Explicit list, given at build time. */
+	while ((*p != '\0') && (ncpus < AFFINITY_CPUS_MAX))
+	{
+		char *end;
+		long cpu = strtol(p, &end, 10);
+
+		if (end == p)
+			break;
+
+		order[ncpus++] = (int) cpu;
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+#else
+
+	if (sched_getaffinity(0, sizeof(set), &set) < 0)
+		return;
+
+	for (int cpu = 0; (cpu < CPU_SETSIZE) && (ncpus < AFFINITY_CPUS_MAX); cpu++)
+	{
+		if (!CPU_ISSET(cpu, &set))
+			continue;
+
+		cpus[ncpus].cpu = cpu;
+		affinity_probe(&cpus[ncpus]);
+		ncpus++;
+	}
+
+	qsort(cpus, ncpus, sizeof(struct affinity_cpu), affinity_cmp_compact);
+
+	/* Rank SMT siblings in a core, and cores in a NUMA node. */
+	for (int i = 0; i < ncpus; i++)
+	{
+		if (i == 0)
+		{
+			cpus[i].sibling = 0;
+			cpus[i].rank = 0;
+		}
+		else if (cpus[i].node != cpus[i - 1].node)
+		{
+			cpus[i].sibling = 0;
+			cpus[i].rank = 0;
+		}
+		else if ((cpus[i].package != cpus[i - 1].package) || (cpus[i].core != cpus[i - 1].core))
+		{
+			cpus[i].sibling = 0;
+			cpus[i].rank = cpus[i - 1].rank + 1;
+		}
+		else
+		{
+			cpus[i].sibling = cpus[i - 1].sibling + 1;
+			cpus[i].rank = cpus[i - 1].rank;
+		}
+	}
+
+	if (AFFINITY_POLICY == AFFINITY_SCATTER)
+		qsort(cpus, ncpus, sizeof(struct affinity_cpu), affinity_cmp_scatter);
+
+	for (int i = 0; i < ncpus; i++)
+		order[i] = cpus[i].cpu;
+
+#endif
+}
+
+#endif
+
+/**
+ * @brief Runs a working thread, after recording where it runs.
+ */
+static void *affinity_trampoline(void *arg)
+{
+	struct affinity_slot *s = arg;
+
+#ifdef __k1__
+	s->actual = k1b_perf_core_id();
+#else
+	s->actual = sched_getcpu();
+
+	/* Per-core data of the master thread is in slot zero. */
+	k1b_perf_core_set((int) (s - slots) + 1);
+#endif
+
+	/* Master reads it. */
+	dcache_invalidate();
+
+	return (s->fn(s->arg));
+}
+
+/**
+ * Creates a working thread, placed according to the placement policy.
+ */
+int affinity_thread_create(pthread_t *tid, int tnum, void *(*fn)(void *), void *arg)
+{
+	pthread_attr_t attr;
+	struct affinity_slot *s;
+	int ret;
+#ifdef FOOTPRINT
+	void *stack;
+#endif
+
+	if ((tnum < 0) || (tnum >= NUM_CORES))
+		return (pthread_create(tid, NULL, fn, arg));
+
+	s = &slots[tnum];
+	s->fn = fn;
+	s->arg = arg;
+	s->requested = -1;
+	s->actual = -1;
+
+	pthread_attr_init(&attr);
+
+#ifndef __k1__
+	if (AFFINITY_POLICY != AFFINITY_NONE)
+	{
+		affinity_init();
+
+		if (ncpus > 0)
+		{
+			cpu_set_t set;
+
+			s->requested = order[tnum % ncpus];
+
+			CPU_ZERO(&set);
+			CPU_SET(s->requested, &set);
+			pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+		}
+	}
+#endif
+
+#ifdef FOOTPRINT
+	/* Stacks are painted to find their high-water marks. */
+	if ((stack = footprint_stack(tnum)) != NULL)
+		pthread_attr_setstack(&attr, stack, FOOTPRINT_STACK_SIZE);
+#endif
+
+	/* Thread reads it. */
+	dcache_invalidate();
+
+	ret = pthread_create(tid, &attr, affinity_trampoline, s);
+
+	pthread_attr_destroy(&attr);
+
+	return (ret);
+}
+
+/**
+ * Places the calling thread as a working thread.
+ */
+void affinity_thread_pin(int tnum)
+{
+#ifndef __k1__
+	cpu_set_t set;
+
+	if ((AFFINITY_POLICY == AFFINITY_NONE) || (tnum < 0))
+		return;
+
+	affinity_init();
+
+	if (ncpus == 0)
+		return;
+
+	CPU_ZERO(&set);
+	CPU_SET(order[tnum % ncpus], &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	UNUSED(tnum);
+#endif
+}
+
+/**
+ * Dumps placement of working threads.
+ */
+void affinity_dump(const char *prefix, int nthreads)
+{
+	/* Slots were written by other cores. */
+	dcache_invalidate();
+
+	for (int i = 0; (i < nthreads) && (i < NUM_CORES); i++)
+	{
+#ifdef NDEBUG
+		printf("%s[affinity] %s %d %d %d %d\n",
+			prefix,
+			policies[AFFINITY_POLICY],
+			nthreads,
+			i,
+			slots[i].requested,
+			slots[i].actual
+		);
+#else
+		printf("%s[affinity] policy=%s    nthreads=%d    thread=%d    requested=%d    actual=%d\n",
+			prefix,
+			policies[AFFINITY_POLICY],
+			nthreads,
+			i,
+			slots[i].requested,
+			slots[i].actual
+		);
+#endif
+	}
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Arena of kernel buffers.
+ */
+static struct
+{
+	char *base;    /**< First Byte (Cache-Aligned) */
+	size_t brk;    /**< Next Free Byte             */
+	size_t peak;   /**< High-Water Mark            */
+	int exhausted; /**< An Allocation Failed?      */
+} arena = { NULL, 0, 0, 0 };
+
+/**
+ * @brief Reserves the arena, once, out of free memory of the cluster.
+ */
+static int arena_reserve(void)
+{
+	char *p;
+
+	if (arena.base != NULL)
+		return (0);
+
+	if ((p = malloc(ARENA_SIZE + CACHE_LINE_SIZE)) == NULL)
+		return (-1);
+
+	arena.base = (char *) CACHE_LINE_ROUNDUP((uintptr_t) p);
+
+	return (0);
+}
+
+/**
+ * Allocates a buffer from the arena.
+ */
+void *arena_alloc(size_t size)
+{
+	void *p;
+
+	size = CACHE_LINE_ROUNDUP(size);
+
+	if ((arena.exhausted) || (arena_reserve() < 0) || (size > ARENA_SIZE - arena.brk))
+	{
+		arena.exhausted = 1;
+		return (NULL);
+	}
+
+	p = arena.base + arena.brk;
+	arena.brk += size;
+
+	if (arena.brk > arena.peak)
+		arena.peak = arena.brk;
+
+	return (p);
+}
+
+/**
+ * Releases all buffers of the arena.
+ */
+void arena_reset(void)
+{
+	arena.brk = 0;
+	arena.peak = 0;
+	arena.exhausted = 0;
+}
+
+/**
+ * Returns the high-water mark of the arena.
+ */
+size_t arena_peak(void)
+{
+	return (arena.peak);
+}
+
+/**
+ * Dumps the high-water mark of the arena.
+ */
+void arena_dump(const char *prefix)
+{
+#ifdef NDEBUG
+	printf("%s[arena] %llu %llu %d\n",
+		prefix,
+		UINT64(ARENA_SIZE),
+		UINT64(arena.peak),
+		arena.exhausted
+	);
+#else
+	printf("%s[arena] size=%llu B    peak=%llu B (%.1f%%)    exhausted=%s\n",
+		prefix,
+		UINT64(ARENA_SIZE),
+		UINT64(arena.peak),
+		100*DOUBLE(arena.peak)/ARENA_SIZE,
+		arena.exhausted ? "yes" : "no"
+	);
+#endif
+}
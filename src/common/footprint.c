@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Static data is measured from linker symbols, which are weak so that
+ * toolchains that lack them report zero. In FOOTPRINT builds, working
+ * threads run on stacks painted with a pattern, and the high-water
+ * mark of a stack is the part of it where the pattern was overwritten.
+ * Stacks grow downwards on both the MPPA-256 and Linux hosts.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cap-bench.h>
+
+/**
+ * @name Bounds of Static Data
+ */
+/**@{*/
+extern char __data_start __attribute__((weak)); /**< First Byte of Data  */
+extern char _end __attribute__((weak));         /**< Last Byte of BSS    */
+/**@}*/
+
+#ifdef FOOTPRINT
+
+/**
+ * @brief Pattern of unused stack bytes.
+ */
+#define FOOTPRINT_PATTERN 0xa5
+
+/**
+ * @brief Stacks of working threads.
+ */
+static unsigned char *stacks[NUM_CORES];
+
+/**
+ * @brief High-water marks of stacks (in bytes).
+ */
+static size_t peaks[NUM_CORES];
+
+/**
+ * @brief Scans the high-water mark of a stack.
+ */
+static void footprint_scan(int tnum)
+{
+	size_t unused = 0;
+
+	while ((unused < FOOTPRINT_STACK_SIZE) && (stacks[tnum][unused] == FOOTPRINT_PATTERN))
+		unused++;
+
+	if (FOOTPRINT_STACK_SIZE - unused > peaks[tnum])
+		peaks[tnum] = FOOTPRINT_STACK_SIZE - unused;
+}
+
+/**
+ * Returns a painted stack for a working thread.
+ */
+void *footprint_stack(int tnum)
+{
+	if ((tnum < 0) || (tnum >= NUM_CORES))
+		return (NULL);
+
+	/* Keep the mark of the last thread that ran on it. */
+	if (stacks[tnum] != NULL)
+		footprint_scan(tnum);
+	else if ((stacks[tnum] = malloc(FOOTPRINT_STACK_SIZE)) == NULL)
+		return (NULL);
+
+	memset(stacks[tnum], FOOTPRINT_PATTERN, FOOTPRINT_STACK_SIZE);
+
+	/* Thread writes it. */
+	dcache_invalidate();
+
+	return (stacks[tnum]);
+}
+
+#endif
+
+/**
+ * Dumps the memory footprint of a kernel.
+ */
+void footprint_dump(const char *prefix, int nthreads)
+{
+	uint64_t data = 0;
+
+	if ((&__data_start != NULL) && (&_end != NULL))
+		data = (uintptr_t) &_end - (uintptr_t) &__data_start;
+
+#ifdef NDEBUG
+	printf("%s[footprint] %d %llu %llu %llu\n",
+		prefix,
+		nthreads,
+		UINT64(data),
+		UINT64(arena_peak()),
+		UINT64(ARENA_SIZE)
+	);
+#else
+	printf("%s[footprint] nthreads=%d    static=%llu B    arena=%llu B (of %llu B)\n",
+		prefix,
+		nthreads,
+		UINT64(data),
+		UINT64(arena_peak()),
+		UINT64(ARENA_SIZE)
+	);
+#endif
+
+#ifdef FOOTPRINT
+
+	/* Stacks were written by other cores. */
+	dcache_invalidate();
+
+	for (int i = 0; (i < nthreads) && (i < NUM_CORES); i++)
+	{
+		if (stacks[i] == NULL)
+			continue;
+
+		footprint_scan(i);
+
+#ifdef NDEBUG
+		printf("%s[footprint][stack] %d %d %llu %llu\n",
+			prefix,
+			nthreads,
+			i,
+			UINT64(peaks[i]),
+			UINT64(FOOTPRINT_STACK_SIZE)
+		);
+#else
+		printf("%s[footprint][stack] nthreads=%d    thread=%d    stack=%llu B (of %llu B)\n",
+			prefix,
+			nthreads,
+			i,
+			UINT64(peaks[i]),
+			UINT64(FOOTPRINT_STACK_SIZE)
+		);
+#endif
+
+		peaks[i] = 0;
+	}
+
+#endif
+}
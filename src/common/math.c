@@ -15,22 +15,83 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <cap-bench.h>
+
+/*
+ * Floating point constants carry an L suffix because the build
+ * passes -fsingle-precision-constant, which would otherwise round
+ * them to single precision.
+ */
+
+/**
+ * @name Constants for Exponentiation
+ */
+/**@{*/
+#define LOG2E    ((double) 1.44269504088896338700e+00L) /**< log2(e)              */
+#define LN2_HI   ((double) 6.93147180369123816490e-01L) /**< ln(2), upper bits    */
+#define LN2_LO   ((double) 1.90821492927058770002e-10L) /**< ln(2), lower bits    */
+#define EXP_MAX  ((double) 7.09782712893383973096e+02L) /**< Largest exponent     */
+#define EXP_MIN  ((double) -7.08396418532264106224e+02L) /**< Smallest exponent    */
+/**@}*/
+
+/**
+ * @brief Magic number for seeding the reciprocal square root.
+ */
+#define RSQRT_MAGIC 0x5fe6eb50c7b537a9ull
+
+/**
+ * @brief Newton-Raphson iterations for reciprocal square root.
+ */
+#define RSQRT_NITERATIONS 4
+
+/**
+ * @brief Bit-level view of a double.
+ */
+union double_bits
+{
+	double d;   /**< Floating point value. */
+	uint64_t u; /**< Raw bits.             */
+};
+
+/**
+ * Computes n^-0.5.
+ */
+double rsquared(double n)
+{
+	double y;
+	union double_bits bits;
+
+	if (n <= 0)
+		return (0);
+
+	/* Seed. */
+	bits.d = n;
+	bits.u = RSQRT_MAGIC - (bits.u >> 1);
+	y = bits.d;
+
+	/* Each iteration doubles the number of correct bits. */
+	for (int i = 0; i < RSQRT_NITERATIONS; i++)
+		y = y*(1.5 - 0.5*n*y*y);
+
+	return (y);
+}
+
 /**
  * Computes n^0.5.
  */
 double squared(double n)
 {
 	double s;
+	double y;
 
 	if (n <= 0)
 		return (0);
 
-	s = n;
-
-	while ((s - n/s) > 0.001)
-		s = (s + n/s)/2;
+	y = rsquared(n);
+	s = n*y;
 
-	return (s);
+	/* Correct last bits, so that perfect squares are exact. */
+	return (s + 0.5*y*(n - s*s));
 }
 
 /**
@@ -38,18 +99,70 @@ double squared(double n)
  */
 double powerd(double x, int y)
 {
-	double temp;
+	double r;
+	unsigned n;
+
+	r = 1.0;
+	n = (y < 0) ? -((unsigned) y) : ((unsigned) y);
+
+	while (n > 0)
+	{
+		if (n & 1)
+			r *= x;
+
+		x *= x;
+		n >>= 1;
+	}
+
+	return ((y < 0) ? 1.0/r : r);
+}
+
+/**
+ * Computes e^x.
+ */
+double exponential(double x)
+{
+	int k;
+	double r;
+	double p;
+	union double_bits bits;
+
+	if (x > EXP_MAX)
+	{
+		bits.u = 0x7ff0000000000000ull;
+		return (bits.d);
+	}
+
+	if (x < EXP_MIN)
+		return (0);
 
-	if (y == 0)
-		return 1;
+	/* Range reduction: x = k*ln(2) + r, with |r| <= ln(2)/2. */
+	k = (int)(x*LOG2E + ((x < 0) ? -0.5 : 0.5));
+	r = (x - k*LN2_HI) - k*LN2_LO;
 
-	temp = powerd(x, y/2);
+	/* Taylor polynomial of degree 12 in Horner form. */
+	p = (double) (1.0L/479001600.0L);
+	p = p*r + (double) (1.0L/39916800.0L);
+	p = p*r + (double) (1.0L/3628800.0L);
+	p = p*r + (double) (1.0L/362880.0L);
+	p = p*r + (double) (1.0L/40320.0L);
+	p = p*r + (double) (1.0L/5040.0L);
+	p = p*r + (double) (1.0L/720.0L);
+	p = p*r + (double) (1.0L/120.0L);
+	p = p*r + (double) (1.0L/24.0L);
+	p = p*r + (double) (1.0L/6.0L);
+	p = p*r + 0.5;
+	p = p*r + 1.0;
+	p = p*r + 1.0;
 
-	if ((y % 2) == 0)
-		return (temp*temp);
+	/* Scale by 2^k, without overflowing the exponent. */
+	if (k > 1023)
+	{
+		k--;
+		p *= 2.0;
+	}
 
-	if (y > 0)
-		return (x*temp*temp);
+	bits.u = ((uint64_t)(k + 1023)) << 52;
 
-	return (temp*temp)/x;
+	return (p*bits.d);
 }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Computes a ratio, guarding against empty denominators.
+ */
+static inline double ratio(uint64_t x, uint64_t y)
+{
+	return ((y == 0) ? 0.0 : DOUBLE(x)/DOUBLE(y));
+}
+
+/**
+ * Computes derived metrics from raw performance counters.
+ */
+void perf_metrics_compute(struct perf_metrics *metrics, const uint64_t *stats)
+{
+	uint64_t cycles = stats[BENCHMARK_PERF_CYCLES];
+	uint64_t events;
+	double stalls;
+	double memory, frontend, latency;
+
+	metrics->bpc = ratio(stats[BENCHMARK_PERF_BUNDLES], cycles);
+
+	metrics->icache_miss_ratio = ratio(
+		stats[BENCHMARK_PERF_ICACHE_MISSES],
+		stats[BENCHMARK_PERF_ICACHE_HITS] + stats[BENCHMARK_PERF_ICACHE_MISSES]
+	);
+	metrics->dcache_miss_ratio = ratio(
+		stats[BENCHMARK_PERF_DCACHE_MISSES],
+		stats[BENCHMARK_PERF_DCACHE_HITS] + stats[BENCHMARK_PERF_DCACHE_MISSES]
+	);
+
+	metrics->icache_stalls = ratio(stats[BENCHMARK_PERF_ICACHE_STALLS], cycles);
+	metrics->dcache_stalls = ratio(stats[BENCHMARK_PERF_DCACHE_STALLS], cycles);
+	metrics->branch_stalls = ratio(stats[BENCHMARK_PERF_BRANCH_STALLS], cycles);
+	metrics->reg_stalls    = ratio(stats[BENCHMARK_PERF_REG_STALLS], cycles);
+	metrics->itlb_stalls   = ratio(stats[BENCHMARK_PERF_ITLB_STALLS], cycles);
+	metrics->dtlb_stalls   = ratio(stats[BENCHMARK_PERF_DTLB_STALLS], cycles);
+	metrics->stream_stalls = ratio(stats[BENCHMARK_PERF_STREAM_STALLS], cycles);
+
+	/*
+	 * Events are sampled in different runs, thus the breakdown may
+	 * not add up exactly to one.
+	 */
+	stalls = metrics->icache_stalls + metrics->dcache_stalls +
+		metrics->branch_stalls + metrics->reg_stalls +
+		metrics->itlb_stalls + metrics->dtlb_stalls +
+		metrics->stream_stalls;
+	metrics->other = 1.0 - metrics->bpc - stalls;
+	if (metrics->other < 0.0)
+		metrics->other = 0.0;
+
+	/*
+	 * Classify by the largest class of stalls, as long as it
+	 * outweighs the cycles spent issuing bundles.
+	 */
+	memory = metrics->dcache_stalls + metrics->dtlb_stalls + metrics->stream_stalls;
+	frontend = metrics->icache_stalls + metrics->itlb_stalls + metrics->branch_stalls;
+	latency = metrics->reg_stalls;
+
+	/* Nothing to classify, if no bundles nor stalls were counted. */
+	events = stats[BENCHMARK_PERF_BUNDLES] +
+		stats[BENCHMARK_PERF_ICACHE_STALLS] + stats[BENCHMARK_PERF_DCACHE_STALLS] +
+		stats[BENCHMARK_PERF_BRANCH_STALLS] + stats[BENCHMARK_PERF_REG_STALLS] +
+		stats[BENCHMARK_PERF_ITLB_STALLS] + stats[BENCHMARK_PERF_DTLB_STALLS] +
+		stats[BENCHMARK_PERF_STREAM_STALLS];
+	metrics->bound = "compute";
+	if ((cycles == 0) || (events == 0))
+		metrics->bound = "n/a";
+	else if ((memory > metrics->bpc) && (memory >= frontend) && (memory >= latency))
+		metrics->bound = "memory";
+	else if ((latency > metrics->bpc) && (latency >= frontend))
+		metrics->bound = "latency";
+	else if (frontend > metrics->bpc)
+		metrics->bound = "frontend";
+}
+
+/**
+ * Dumps derived metrics from raw performance counters.
+ */
+void perf_metrics_dump(const char *prefix, int it, int nthreads, const uint64_t *stats)
+{
+	struct perf_metrics m;
+
+	perf_metrics_compute(&m, stats);
+
+#ifdef NDEBUG
+	printf("%s[metrics] %d %d %.3f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %s\n",
+		prefix,
+		it,
+		nthreads,
+		m.bpc,
+		m.icache_miss_ratio,
+		m.dcache_miss_ratio,
+		m.icache_stalls,
+		m.dcache_stalls,
+		m.branch_stalls,
+		m.reg_stalls,
+		m.itlb_stalls,
+		m.dtlb_stalls,
+		m.stream_stalls,
+		m.other,
+		m.bound
+	);
+#else
+	UNUSED(it);
+
+	printf("%s[metrics] nthreads=%d    bpc=%.2f    imiss=%.2f%%    dmiss=%.2f%%    "
+		"stalls: imiss=%.1f%% dmiss=%.1f%% branch=%.1f%% raw=%.1f%% itlb=%.1f%% dtlb=%.1f%% stream=%.1f%%    "
+		"bound=%s\n",
+		prefix,
+		nthreads,
+		m.bpc,
+		100*m.icache_miss_ratio,
+		100*m.dcache_miss_ratio,
+		100*m.icache_stalls,
+		100*m.dcache_stalls,
+		100*m.branch_stalls,
+		100*m.reg_stalls,
+		100*m.itlb_stalls,
+		100*m.dtlb_stalls,
+		100*m.stream_stalls,
+		m.bound
+	);
+#endif
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Both variants of a kernel split work the same way and are timed by
+ * the master thread, from fork to join of a parallel pass. Hand-rolled
+ * pthread code spawns and joins its threads, whereas the OpenMP runtime
+ * keeps a pool of threads, schedules loops and tasks, and synchronizes
+ * on implicit barriers. The difference between both times is the
+ * overhead of the runtime.
+ *
+ * Variants take turns in running first in an iteration, and threads of
+ * a team are pinned to the CPUs of the working threads that they stand
+ * for, so that neither variant is favored by warm caches or placement.
+ * Team threads also get per-core data of their own, and profiling
+ * regions entered by either variant are discarded, as they are not
+ * reported.
+ */
+
+#ifdef OPENMP
+	#include <omp.h>
+#endif
+
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Clears profiling regions of all cores.
+ */
+static void openmp_regions_clear(void)
+{
+	for (int core = 0; core < K1B_PERF_CORES_NUM; core++)
+		k1b_perf_region_clear(core);
+}
+
+#ifdef OPENMP
+
+/**
+ * Places the threads of OpenMP teams.
+ */
+void openmp_bind(int nthreads)
+{
+	/* Placement is set up before threads of the team read it. */
+	affinity_thread_pin(0);
+
+	/* The runtime keeps threads of a team across parallel regions. */
+	#pragma omp parallel num_threads(nthreads)
+	{
+		int tnum = omp_get_thread_num();
+
+		affinity_thread_pin(tnum);
+
+#ifndef __k1__
+		/* Per-core data of the master thread is in slot zero. */
+		if (tnum > 0)
+			k1b_perf_core_set(tnum + 1);
+#endif
+	}
+
+	openmp_regions_clear();
+}
+
+#endif
+
+/**
+ * Dumps the overhead of the OpenMP variant of a kernel.
+ */
+void openmp_dump(const char *prefix, int nthreads, uint64_t pthreads, uint64_t openmp)
+{
+	double overhead;
+
+	/* Regions entered by team threads are not reported. */
+	openmp_regions_clear();
+
+	if (pthreads == 0)
+		return;
+
+	overhead = (DOUBLE(openmp) - DOUBLE(pthreads))/DOUBLE(pthreads);
+
+#ifdef NDEBUG
+	printf("%s[openmp] %d %llu %llu %.4f\n",
+		prefix,
+		nthreads,
+		UINT64(pthreads),
+		UINT64(openmp),
+		overhead
+	);
+#else
+	printf("%s[openmp] nthreads=%d    pthreads=%.2f us    openmp=%.2f us    overhead=%+.1f%%\n",
+		prefix,
+		nthreads,
+		CYCLES_TO_USECONDS(pthreads),
+		CYCLES_TO_USECONDS(openmp),
+		100*overhead
+	);
+#endif
+}
@@ -14,7 +14,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-
+#include <stdio.h>
 
 #include <cap-bench.h>
 
@@ -37,3 +37,132 @@ int k1b_perf_events[BENCHMARK_PERF_EVENTS] = {
 	K1B_PERF_DTLB_STALLS,
 	K1B_PERF_STREAM_STALLS
 };
+
+/**
+ * @brief Number of calibration runs.
+ */
+#define CALIBRATION_NITERATIONS 32
+
+/**
+ * @brief Slack on the rate of events per cycle, since events are
+ * sampled in different runs.
+ */
+#define EVENTS_PER_CYCLE_MAX 2
+
+/**
+ * @brief Instrumentation overhead of each performance event.
+ */
+static uint64_t overhead[BENCHMARK_PERF_EVENTS];
+
+/**
+ * Measures the instrumentation overhead of each performance event.
+ */
+void perf_overhead_calibrate(void)
+{
+	for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+	{
+		overhead[j] = UINT64_MAX;
+
+		/* Same instrumentation as kernels, around an empty region. */
+		for (int i = 0; i < (CALIBRATION_NITERATIONS + SKIP); i++)
+		{
+			uint64_t x;
+
+			k1b_perf_start(0, k1b_perf_events[j]);
+			k1b_perf_stop(0);
+
+			x = k1b_perf_read(0);
+
+			if (x == K1B_PERF_INVALID)
+				continue;
+
+			if ((i >= SKIP) && (x < overhead[j]))
+				overhead[j] = x;
+		}
+	}
+}
+
+/**
+ * Subtracts instrumentation overhead from a performance event.
+ */
+uint64_t perf_overhead_subtract(int event, uint64_t raw)
+{
+	if (raw == K1B_PERF_INVALID)
+		return (raw);
+
+	return ((raw > overhead[event]) ? (raw - overhead[event]) : 0);
+}
+
+/**
+ * Subtracts instrumentation overhead from all performance events.
+ */
+void perf_overhead_correct(uint64_t *corrected, const uint64_t *raw)
+{
+	for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+		corrected[j] = perf_overhead_subtract(j, raw[j]);
+}
+
+/**
+ * Dumps the instrumentation overhead of each performance event.
+ */
+void perf_overhead_dump(const char *prefix)
+{
+	char buf[PERF_STATS_STRLEN];
+
+	perf_stats_format(buf, sizeof(buf), overhead);
+
+	printf("%s[overhead] %s\n", prefix, buf);
+}
+
+/**
+ * Checks performance events for failed or overflowed reads. Apart
+ * from cycles, monitored events happen at most once per cycle, thus
+ * any event well above the cycle count comes from a lost carry. On
+ * Linux hosts, cycles are wall-clock time, thus only failed reads are
+ * detected.
+ */
+int perf_stats_check(const char *prefix, int it, int nthreads, const uint64_t *stats)
+{
+	int n = 0;
+
+	for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+	{
+		const char *reason;
+
+		if (stats[j] == K1B_PERF_INVALID)
+			reason = "invalid";
+#ifdef __k1__
+		else if ((j != BENCHMARK_PERF_CYCLES) && (stats[BENCHMARK_PERF_CYCLES] != K1B_PERF_INVALID) &&
+				(stats[j]/EVENTS_PER_CYCLE_MAX > stats[BENCHMARK_PERF_CYCLES]))
+			reason = "overflow";
+#endif
+		else
+			continue;
+
+		printf("%s[warning] %d %d event=%d %s %llu\n",
+			prefix,
+			it,
+			nthreads,
+			j,
+			reason,
+			UINT64(stats[j])
+		);
+
+		n++;
+	}
+
+	return (n);
+}
+
+/**
+ * Formats performance events.
+ */
+void perf_stats_format(char *buf, int len, const uint64_t *stats)
+{
+	int n = 0;
+
+	buf[0] = '\0';
+
+	for (int j = 0; (j < BENCHMARK_PERF_EVENTS) && (n < len); j++)
+		n += snprintf(&buf[n], len - n, (j == 0) ? "%llu" : " %llu", UINT64(stats[j]));
+}
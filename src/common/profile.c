@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * Dumps and clears statistics of profiling regions.
+ */
+void perf_regions_dump(const char *prefix, int it, int nthreads)
+{
+	/* Regions were updated by other cores. */
+	dcache_invalidate();
+
+	for (int core = 0; core < K1B_PERF_CORES_NUM; core++)
+	{
+		for (int region = 0; region < K1B_PERF_REGIONS_NUM; region++)
+		{
+			const char *name;
+			struct k1b_perf_region stats;
+
+			k1b_perf_region_read(core, region, &stats);
+
+			if (stats.count == 0)
+				continue;
+
+			name = k1b_perf_region_name(region);
+
+#ifdef NDEBUG
+			printf("%s[region] %d %d %d %s %llu %llu %llu\n",
+				prefix,
+				it,
+				nthreads,
+				core,
+				(name != NULL) ? name : "-",
+				UINT64(stats.count),
+				UINT64(stats.inclusive),
+				UINT64(stats.exclusive)
+			);
+#else
+			UNUSED(it);
+
+			printf("%s[region] nthreads=%d core=%d    region=%-10s    count=%llu    inclusive=%llu    exclusive=%llu\n",
+				prefix,
+				nthreads,
+				core,
+				(name != NULL) ? name : "-",
+				UINT64(stats.count),
+				UINT64(stats.inclusive),
+				UINT64(stats.exclusive)
+			);
+#endif
+		}
+
+		k1b_perf_region_clear(core);
+	}
+}
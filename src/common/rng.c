@@ -42,3 +42,134 @@ unsigned rng_next(struct rng_state * state)
 	return ((state->z << 16) + state->w);
 }
 
+/*============================================================================*
+ * Parallel Streams                                                           *
+ *============================================================================*/
+
+/*
+ * Streams are built on top of xoshiro128**. Each stream is 2^64
+ * numbers apart from the previous one, thus streams do not overlap.
+ */
+
+/**
+ * @brief Rotates a 32-bit word to the left.
+ */
+static inline uint32_t rotl(uint32_t x, int k)
+{
+	return ((x << k) | (x >> (32 - k)));
+}
+
+/**
+ * @brief Next output of splitmix64, used for seeding streams.
+ */
+static uint64_t splitmix64(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+
+	z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+
+	return (z ^ (z >> 31));
+}
+
+/**
+ * Returns the next pseudo-random number of a stream.
+ */
+unsigned rng_stream_next(struct rng_stream *stream)
+{
+	uint32_t *s = stream->s;
+	uint32_t result;
+	uint32_t t;
+
+	result = rotl(s[1]*5, 7)*9;
+	t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+
+	return (result);
+}
+
+/**
+ * Advances a stream by 2^64 numbers.
+ */
+void rng_stream_jump(struct rng_stream *stream)
+{
+	static const uint32_t jump[4] = {
+		0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b
+	};
+	uint32_t s[4] = { 0, 0, 0, 0 };
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int b = 0; b < 32; b++)
+		{
+			if (jump[i] & (UINT32_C(1) << b))
+			{
+				s[0] ^= stream->s[0];
+				s[1] ^= stream->s[1];
+				s[2] ^= stream->s[2];
+				s[3] ^= stream->s[3];
+			}
+
+			rng_stream_next(stream);
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+		stream->s[i] = s[i];
+}
+
+/**
+ * Initializes a pseudo-random number stream.
+ */
+void rng_stream_initialize(struct rng_stream *stream, unsigned seed, int id)
+{
+	uint64_t x = seed;
+	uint64_t z;
+
+	z = splitmix64(&x);
+	stream->s[0] = UINT32(z);
+	stream->s[1] = UINT32(z >> 32);
+	z = splitmix64(&x);
+	stream->s[2] = UINT32(z);
+	stream->s[3] = UINT32(z >> 32);
+
+	for (int i = 0; i < id; i++)
+		rng_stream_jump(stream);
+}
+
+/**
+ * Fills a buffer with pseudo-random numbers of a stream.
+ */
+void rng_stream_fill(struct rng_stream *stream, unsigned *buf, int n)
+{
+	uint32_t s0 = stream->s[0];
+	uint32_t s1 = stream->s[1];
+	uint32_t s2 = stream->s[2];
+	uint32_t s3 = stream->s[3];
+
+	/* Keep the state in registers. */
+	for (int i = 0; i < n; i++)
+	{
+		uint32_t t = s1 << 9;
+
+		buf[i] = rotl(s1*5, 7)*9;
+
+		s2 ^= s0;
+		s3 ^= s1;
+		s1 ^= s2;
+		s0 ^= s3;
+		s2 ^= t;
+		s3 = rotl(s3, 11);
+	}
+
+	stream->s[0] = s0;
+	stream->s[1] = s1;
+	stream->s[2] = s2;
+	stream->s[3] = s3;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * Dumps the roofline point of a kernel. Ceilings are measured by the
+ * FPU and STREAM kernels, and tools/roofline combines them with these
+ * points. Compute-only kernels have no intensity, and they are only
+ * compared against the compute ceiling.
+ */
+void roofline_dump(const char *prefix, int nthreads, double flops, double bytes, uint64_t cycles)
+{
+	double gflops;
+	char intensity[32];
+
+	if (cycles == 0)
+		return;
+
+	/* Operations per microsecond, scaled to GFLOPS. */
+	gflops = flops/CYCLES_TO_USECONDS(cycles)/1000;
+
+	if (bytes > 0.0)
+		snprintf(intensity, sizeof(intensity), "%.4f", flops/bytes);
+	else
+		snprintf(intensity, sizeof(intensity), "n/a");
+
+#ifdef NDEBUG
+	printf("%s[roofline] %d %.0f %.0f %llu %s %.4f\n",
+		prefix,
+		nthreads,
+		flops,
+		bytes,
+		UINT64(cycles),
+		intensity,
+		gflops
+	);
+#else
+	printf("%s[roofline] nthreads=%d    intensity=%s flops/B    performance=%.4f GFLOPS\n",
+		prefix,
+		nthreads,
+		intensity,
+		gflops
+	);
+#endif
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Scaling mode.
+ */
+#ifdef WEAK_SCALING
+	#define SCALING_MODE "weak"
+#else
+	#define SCALING_MODE "strong"
+#endif
+
+/**
+ * @brief Execution time of a thread in each iteration.
+ */
+struct scaling_samples
+{
+	uint64_t cycles[NITERATIONS]; /**< Cycles */
+} ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Samples of working threads.
+ */
+static struct scaling_samples samples[NUM_CORES];
+
+/**
+ * @brief Execution time of a number of threads.
+ */
+static struct
+{
+	int nthreads;   /**< Number of Working Threads */
+	uint64_t cycles; /**< Parallel Execution Time   */
+} points[NUM_CORES];
+
+/**
+ * @brief Number of points in the sweep.
+ */
+static int npoints = 0;
+
+/**
+ * Records the execution time of a thread in an iteration.
+ */
+void scaling_sample(int tnum, int it, uint64_t cycles)
+{
+	samples[tnum].cycles[it] = perf_overhead_subtract(BENCHMARK_PERF_CYCLES, cycles);
+
+	/* Master reads it. */
+	dcache_invalidate();
+}
+
+/**
+ * Records the execution time of a number of threads. In each
+ * iteration, the slowest thread gives the parallel time, and the
+ * fastest iteration is kept.
+ */
+uint64_t scaling_record(int nthreads)
+{
+	uint64_t best = UINT64_MAX;
+
+	/* Samples were written by other cores. */
+	dcache_invalidate();
+
+	for (int it = 0; it < NITERATIONS; it++)
+	{
+		uint64_t slowest = 0;
+
+		for (int i = 0; i < nthreads; i++)
+		{
+			if (samples[i].cycles[it] > slowest)
+				slowest = samples[i].cycles[it];
+
+			samples[i].cycles[it] = 0;
+		}
+
+		if (slowest < best)
+			best = slowest;
+	}
+
+	if (best == 0)
+		return (0);
+
+	if (npoints < NUM_CORES)
+	{
+		points[npoints].nthreads = nthreads;
+		points[npoints].cycles = best;
+		npoints++;
+	}
+
+	return (best);
+}
+
+/**
+ * Dumps scaling analysis of recorded points and starts a new sweep.
+ *
+ * Speedup is relative to the smallest number of threads, assuming
+ * that it scales perfectly. In weak scaling, work grows with threads,
+ * thus the scaled speedup is reported instead. The serial fraction is
+ * fitted to Amdahl's law, T(p)/T(1) = f + (1 - f)/p, and to
+ * Gustafson's law, S(p) = p - f*(p - 1), by least squares.
+ */
+void scaling_dump(const char *prefix)
+{
+	double t0;
+	double amdahl[2] = { 0.0, 0.0 };
+	double gustafson[2] = { 0.0, 0.0 };
+
+	if (npoints == 0)
+		return;
+
+	/* Time of a single thread, assuming perfect scaling. */
+#ifdef WEAK_SCALING
+	t0 = DOUBLE(points[0].cycles);
+#else
+	t0 = DOUBLE(points[0].cycles)*points[0].nthreads;
+#endif
+
+	for (int i = 0; i < npoints; i++)
+	{
+		int p = points[i].nthreads;
+#ifdef WEAK_SCALING
+		double speedup = p*t0/DOUBLE(points[i].cycles);
+#else
+		double speedup = t0/DOUBLE(points[i].cycles);
+#endif
+		double efficiency = speedup/p;
+		double karp_flatt = 0.0;
+		double x = 1.0/p;
+
+		/* Experimentally determined serial fraction. */
+		if (p > 1)
+			karp_flatt = (1.0/speedup - x)/(1.0 - x);
+
+		amdahl[0] += (1.0/speedup - x)*(1.0 - x);
+		amdahl[1] += (1.0 - x)*(1.0 - x);
+		gustafson[0] += (p - speedup)*(p - 1);
+		gustafson[1] += DOUBLE(p - 1)*(p - 1);
+
+#ifdef NDEBUG
+		printf("%s[scaling] %d %llu %.3f %.3f %.4f %s\n",
+			prefix,
+			p,
+			UINT64(points[i].cycles),
+			speedup,
+			efficiency,
+			karp_flatt,
+			(efficiency < SCALING_EFFICIENCY_MIN) ? "poor" : "ok"
+		);
+#else
+		printf("%s[scaling] nthreads=%d    time=%.2f us    speedup=%.2f    efficiency=%.1f%%    karp-flatt=%.4f%s\n",
+			prefix,
+			p,
+			CYCLES_TO_USECONDS(points[i].cycles),
+			speedup,
+			100*efficiency,
+			karp_flatt,
+			(efficiency < SCALING_EFFICIENCY_MIN) ? "    (poor scaling)" : ""
+		);
+#endif
+	}
+
+	amdahl[0] = (amdahl[1] > 0.0) ? amdahl[0]/amdahl[1] : 0.0;
+	gustafson[0] = (gustafson[1] > 0.0) ? gustafson[0]/gustafson[1] : 0.0;
+
+#ifdef NDEBUG
+	printf("%s[scaling][fit] %s %d %.4f %.4f\n",
+		prefix,
+		SCALING_MODE,
+		npoints,
+		amdahl[0],
+		gustafson[0]
+	);
+#else
+	printf("%s[scaling][fit] mode=%s    npoints=%d    amdahl=%.4f    gustafson=%.4f\n",
+		prefix,
+		SCALING_MODE,
+		npoints,
+		amdahl[0],
+		gustafson[0]
+	);
+#endif
+
+	npoints = 0;
+}
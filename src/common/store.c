@@ -0,0 +1,657 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A backing store holds data that does not fit in local memory, and
+ * staging buffers move pieces of it in and out asynchronously.
+ *
+ * On compute clusters of the MPPA-256, the backing store is DDR. The
+ * IO cluster serves it on top of the transport: requests go to its
+ * inbox, and it writes reads straight into staging buffers, which are
+ * inbox slots of the compute cluster. On the IO cluster, DDR is local,
+ * so transfers complete on issue. On Linux hosts, the backing store is
+ * a memory-mapped file, and a thread plays the role of a DMA engine.
+ */
+
+#ifndef __k1__
+	#define _GNU_SOURCE
+	#include <pthread.h>
+	#include <string.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#elif !defined(__node__)
+	#include <string.h>
+#endif
+
+#include <stdlib.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Staging buffers.
+ */
+static void *buffers[STORE_BUFFERS_MAX];
+
+/**
+ * @brief Sizes of staging buffers (in bytes).
+ */
+static size_t sizes[STORE_BUFFERS_MAX];
+
+/**
+ * @brief Asserts a transfer from or to a staging buffer.
+ */
+static inline int transfer_check(int id, size_t size)
+{
+	return ((id >= 0) && (id < STORE_BUFFERS_MAX) && (buffers[id] != NULL) && (size <= sizes[id]));
+}
+
+#ifdef __k1__
+
+/*============================================================================*
+ * MPPA-256 Protocol                                                          *
+ *============================================================================*/
+
+/**
+ * @name Inbox Slots of the Compute Cluster
+ */
+/**@{*/
+#define SLOT_ACK        0          /**< Acknowledge of Requests */
+#define SLOT_BUFFER(id) (1 + (id)) /**< Staging Buffer          */
+/**@}*/
+
+/**
+ * @name Inbox Slots of the IO Cluster
+ */
+/**@{*/
+#define SLOT_REQUEST 0 /**< Requests        */
+#define SLOT_PUT     1 /**< Data of Writes  */
+/**@}*/
+
+/**
+ * @name Operations
+ */
+/**@{*/
+#define OP_GET   0 /**< Read from the Store  */
+#define OP_PUT   1 /**< Write to the Store   */
+#define OP_CLOSE 2 /**< Stop the Server      */
+/**@}*/
+
+/**
+ * @brief Request of a compute cluster to the IO cluster.
+ */
+struct request
+{
+	int op;        /**< Operation                 */
+	int id;        /**< Staging Buffer            */
+	size_t offset; /**< Offset in the Store       */
+	size_t size;   /**< Number of Bytes           */
+};
+
+#endif
+
+#if defined(__node__)
+
+/*============================================================================*
+ * MPPA-256 Compute Cluster Backend                                           *
+ *============================================================================*/
+
+/**
+ * @brief Last request sent. It must not change until acknowledged.
+ */
+static struct request request;
+
+/**
+ * @brief Is an acknowledge pending?
+ */
+static int pending = 0;
+
+/**
+ * @brief Waits for the acknowledge of the last request.
+ */
+static void store_ack(void)
+{
+	if (!pending)
+		return;
+
+	transport_wait(SLOT_ACK);
+	pending = 0;
+}
+
+/**
+ * @brief Sends a request to the IO cluster. The inbox of the IO
+ * cluster holds one request, thus the last one must be acknowledged
+ * first.
+ */
+static void store_request(int op, int id, size_t offset, size_t size)
+{
+	store_ack();
+
+	request.op = op;
+	request.id = id;
+	request.offset = offset;
+	request.size = size;
+
+	transport_send(TRANSPORT_MASTER, SLOT_REQUEST, &request, sizeof(struct request), 0);
+	pending = 1;
+}
+
+/**
+ * Allocates a staging buffer.
+ */
+void *store_buffer(int id, size_t size)
+{
+	if ((id < 0) || (id >= STORE_BUFFERS_MAX) || (size > STORE_TRANSFER_MAX))
+		return (NULL);
+
+	if ((buffers[id] = transport_open(SLOT_BUFFER(id), size)) != NULL)
+		sizes[id] = size;
+
+	return (buffers[id]);
+}
+
+/**
+ * Opens the backing store.
+ */
+int store_open(size_t size)
+{
+	UNUSED(size);
+
+	if (transport_open(SLOT_ACK, sizeof(int)) == NULL)
+		return (-1);
+
+	/* The IO cluster opens its inbox. */
+	transport_barrier();
+
+	return (0);
+}
+
+/**
+ * Closes the backing store.
+ */
+void store_close(void)
+{
+	store_request(OP_CLOSE, 0, 0, 0);
+	transport_close();
+
+	for (int i = 0; i < STORE_BUFFERS_MAX; i++)
+		buffers[i] = NULL;
+
+	pending = 0;
+}
+
+/**
+ * Starts a read from the backing store.
+ */
+int store_get(int id, size_t offset, size_t size)
+{
+	if (!transfer_check(id, size))
+		return (-1);
+
+	store_request(OP_GET, id, offset, size);
+
+	return (id);
+}
+
+/**
+ * Starts a write to the backing store.
+ */
+int store_put(int id, size_t offset, size_t size)
+{
+	if (!transfer_check(id, size))
+		return (-1);
+
+	/* The IO cluster is done with the last write. */
+	store_ack();
+
+	transport_send(TRANSPORT_MASTER, SLOT_PUT, buffers[id], size, 0);
+	store_request(OP_PUT, id, offset, size);
+
+	return (STORE_BUFFERS_MAX);
+}
+
+/**
+ * Waits for a transfer to complete.
+ */
+void store_wait(int req)
+{
+	if ((req >= 0) && (req < STORE_BUFFERS_MAX))
+		transport_wait(SLOT_BUFFER(req));
+
+	/* Writes complete when acknowledged. */
+	else if (req == STORE_BUFFERS_MAX)
+		store_ack();
+}
+
+/**
+ * Serves the backing store.
+ */
+int store_serve(size_t size)
+{
+	UNUSED(size);
+
+	return (-1);
+}
+
+#elif defined(__k1__)
+
+/*============================================================================*
+ * MPPA-256 IO Cluster Backend                                                *
+ *============================================================================*/
+
+/**
+ * @brief Backing store.
+ */
+static char *store = NULL;
+
+/**
+ * @brief Size of the backing store (in bytes).
+ */
+static size_t store_size = 0;
+
+/**
+ * @brief Asserts a range of the backing store.
+ */
+static inline int range_check(size_t offset, size_t size)
+{
+	return ((store != NULL) && (offset + size <= store_size));
+}
+
+/**
+ * Allocates a staging buffer.
+ */
+void *store_buffer(int id, size_t size)
+{
+	if ((id < 0) || (id >= STORE_BUFFERS_MAX) || (size > STORE_TRANSFER_MAX))
+		return (NULL);
+
+	if ((buffers[id] = malloc(CACHE_LINE_ROUNDUP(size))) != NULL)
+		sizes[id] = size;
+
+	return (buffers[id]);
+}
+
+/**
+ * Opens the backing store.
+ */
+int store_open(size_t size)
+{
+	if ((store = malloc(size)) == NULL)
+		return (-1);
+
+	store_size = size;
+
+	return (0);
+}
+
+/**
+ * Closes the backing store.
+ */
+void store_close(void)
+{
+	for (int i = 0; i < STORE_BUFFERS_MAX; i++)
+	{
+		free(buffers[i]);
+		buffers[i] = NULL;
+	}
+
+	free(store);
+	store = NULL;
+}
+
+/**
+ * Starts a read from the backing store.
+ */
+int store_get(int id, size_t offset, size_t size)
+{
+	if ((!transfer_check(id, size)) || (!range_check(offset, size)))
+		return (-1);
+
+	memcpy(buffers[id], store + offset, size);
+
+	return (0);
+}
+
+/**
+ * Starts a write to the backing store.
+ */
+int store_put(int id, size_t offset, size_t size)
+{
+	if ((!transfer_check(id, size)) || (!range_check(offset, size)))
+		return (-1);
+
+	memcpy(store + offset, buffers[id], size);
+
+	return (0);
+}
+
+/**
+ * Waits for a transfer to complete.
+ */
+void store_wait(int req)
+{
+	UNUSED(req);
+}
+
+/**
+ * Serves the backing store.
+ */
+int store_serve(size_t size)
+{
+	static const int ack = 1;
+	struct request *inbox;
+	char *put;
+
+	if (store_open(size) < 0)
+		return (-1);
+
+	inbox = transport_open(SLOT_REQUEST, sizeof(struct request));
+	put = transport_open(SLOT_PUT, STORE_TRANSFER_MAX);
+
+	if ((inbox == NULL) || (put == NULL))
+		return (-1);
+
+	transport_barrier();
+
+	for (;;)
+	{
+		struct request r;
+
+		transport_wait(SLOT_REQUEST);
+		r = *inbox;
+
+		if (r.op == OP_CLOSE)
+			break;
+
+		if (!range_check(r.offset, r.size))
+			return (-1);
+
+		if (r.op == OP_GET)
+		{
+			/* The inbox is free again. */
+			transport_send(0, SLOT_ACK, &ack, sizeof(int), 0);
+			transport_send(0, SLOT_BUFFER(r.id), store + r.offset, r.size, 0);
+		}
+		else
+		{
+			transport_wait(SLOT_PUT);
+			memcpy(store + r.offset, put, r.size);
+			transport_send(0, SLOT_ACK, &ack, sizeof(int), 0);
+		}
+	}
+
+	transport_close();
+	store_close();
+
+	return (0);
+}
+
+#else
+
+/*============================================================================*
+ * Linux Host Backend                                                         *
+ *============================================================================*/
+
+/**
+ * @brief Maximum number of transfers in flight.
+ */
+#define STORE_REQUESTS_MAX 16
+
+/**
+ * @brief Transfer.
+ */
+static struct
+{
+	int put;       /**< Write to the Store? */
+	int id;        /**< Staging Buffer      */
+	size_t offset; /**< Offset in the Store */
+	size_t size;   /**< Number of Bytes     */
+} requests[STORE_REQUESTS_MAX];
+
+/**
+ * @name Transfer Queue
+ */
+/**@{*/
+static int nsubmitted = 0; /**< Transfers Issued    */
+static int ncompleted = 0; /**< Transfers Completed */
+static int running = 0;    /**< DMA Engine Running? */
+/**@}*/
+
+/**
+ * @name Synchronization of the DMA Engine
+ */
+/**@{*/
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; /**< Lock of the Queue       */
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;   /**< Changes of the Queue    */
+static pthread_t engine;                                 /**< DMA Engine              */
+/**@}*/
+
+/**
+ * @brief Backing store.
+ */
+static char *store = NULL;
+
+/**
+ * @brief Size of the backing store (in bytes).
+ */
+static size_t store_size = 0;
+
+/**
+ * @brief Asserts a range of the backing store.
+ */
+static inline int range_check(size_t offset, size_t size)
+{
+	return ((store != NULL) && (offset + size <= store_size));
+}
+
+/**
+ * @brief Carries out transfers in order.
+ */
+static void *dma_engine(void *arg)
+{
+	UNUSED(arg);
+
+	pthread_mutex_lock(&lock);
+
+	for (;;)
+	{
+		int req;
+
+		while (running && (ncompleted == nsubmitted))
+			pthread_cond_wait(&cond, &lock);
+
+		if (ncompleted == nsubmitted)
+			break;
+
+		req = ncompleted%STORE_REQUESTS_MAX;
+
+		pthread_mutex_unlock(&lock);
+
+			if (requests[req].put)
+				memcpy(store + requests[req].offset, buffers[requests[req].id], requests[req].size);
+			else
+				memcpy(buffers[requests[req].id], store + requests[req].offset, requests[req].size);
+
+		pthread_mutex_lock(&lock);
+
+		ncompleted++;
+		pthread_cond_broadcast(&cond);
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	return (NULL);
+}
+
+/**
+ * @brief Queues a transfer.
+ *
+ * @returns A transfer request.
+ */
+static int store_submit(int put, int id, size_t offset, size_t size)
+{
+	int req;
+
+	pthread_mutex_lock(&lock);
+
+	while (nsubmitted - ncompleted == STORE_REQUESTS_MAX)
+		pthread_cond_wait(&cond, &lock);
+
+	req = nsubmitted%STORE_REQUESTS_MAX;
+	requests[req].put = put;
+	requests[req].id = id;
+	requests[req].offset = offset;
+	requests[req].size = size;
+
+	req = nsubmitted++;
+	pthread_cond_broadcast(&cond);
+
+	pthread_mutex_unlock(&lock);
+
+	return (req);
+}
+
+/**
+ * Allocates a staging buffer.
+ */
+void *store_buffer(int id, size_t size)
+{
+	if ((id < 0) || (id >= STORE_BUFFERS_MAX) || (size > STORE_TRANSFER_MAX))
+		return (NULL);
+
+	if ((buffers[id] = malloc(CACHE_LINE_ROUNDUP(size))) != NULL)
+		sizes[id] = size;
+
+	return (buffers[id]);
+}
+
+/**
+ * Opens the backing store.
+ */
+int store_open(size_t size)
+{
+	char path[] = STORE_DIRECTORY "/cap-bench-XXXXXX";
+	void *p;
+	int fd;
+
+	if ((fd = mkstemp(path)) < 0)
+		return (-1);
+
+	/* The file goes away with the mapping. */
+	unlink(path);
+
+	if (ftruncate(fd, size) < 0)
+	{
+		close(fd);
+		return (-1);
+	}
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (p == MAP_FAILED)
+		return (-1);
+
+	store = p;
+	store_size = size;
+
+	running = 1;
+	if (pthread_create(&engine, NULL, dma_engine, NULL) != 0)
+	{
+		munmap(store, store_size);
+		store = NULL;
+		running = 0;
+		return (-1);
+	}
+
+	return (0);
+}
+
+/**
+ * Closes the backing store.
+ */
+void store_close(void)
+{
+	if (store == NULL)
+		return;
+
+	/* Pending transfers complete first. */
+	pthread_mutex_lock(&lock);
+	running = 0;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+
+	pthread_join(engine, NULL);
+
+	for (int i = 0; i < STORE_BUFFERS_MAX; i++)
+	{
+		free(buffers[i]);
+		buffers[i] = NULL;
+	}
+
+	munmap(store, store_size);
+	store = NULL;
+}
+
+/**
+ * Starts a read from the backing store.
+ */
+int store_get(int id, size_t offset, size_t size)
+{
+	if ((!transfer_check(id, size)) || (!range_check(offset, size)))
+		return (-1);
+
+	return (store_submit(0, id, offset, size));
+}
+
+/**
+ * Starts a write to the backing store.
+ */
+int store_put(int id, size_t offset, size_t size)
+{
+	if ((!transfer_check(id, size)) || (!range_check(offset, size)))
+		return (-1);
+
+	return (store_submit(1, id, offset, size));
+}
+
+/**
+ * Waits for a transfer to complete.
+ */
+void store_wait(int req)
+{
+	if (req < 0)
+		return;
+
+	pthread_mutex_lock(&lock);
+
+	while (ncompleted <= req)
+		pthread_cond_wait(&cond, &lock);
+
+	pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Serves the backing store.
+ */
+int store_serve(size_t size)
+{
+	UNUSED(size);
+
+	return (-1);
+}
+
+#endif
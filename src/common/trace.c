@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Trace records per core.
+ *
+ * Buffers are only allocated if tracing is enabled.
+ */
+#ifdef TRACE
+	#define TRACE_BUFFER_SIZE 1024
+#else
+	#define TRACE_BUFFER_SIZE 1
+#endif
+
+/**
+ * @name Layout of a Trace Record
+ *
+ * A record is a single 64-bit word, so that recording an event costs
+ * a timestamp read and a store.
+ */
+/**@{*/
+#define TRACE_TIMESTAMP_MASK ((1ull << 56) - 1)                     /**< Timestamp */
+#define TRACE_EVENT(x)       ((int) (((x) >> 56) & 0x3f))           /**< Event     */
+#define TRACE_PHASE(x)       ((int) (((x) >> 62) & 0x3))            /**< Phase     */
+#define TRACE_TIMESTAMP(x)   ((x) & TRACE_TIMESTAMP_MASK)           /**< Timestamp */
+/**@}*/
+
+/**
+ * @brief Trace buffer of a core.
+ */
+struct trace_buffer
+{
+	uint64_t records[TRACE_BUFFER_SIZE]; /**< Trace Records   */
+	int n;                               /**< Records Used    */
+	int dropped;                         /**< Records Dropped */
+} ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Trace buffers.
+ */
+static struct trace_buffer buffers[NUM_CORES];
+
+/**
+ * @brief Names of trace events.
+ */
+static const char *names[TRACE_EVENTS_NUM];
+
+/**
+ * @brief Names of phases, as in the Chrome trace format.
+ */
+static const char phases[] = { 'B', 'E', 'i', '?' };
+
+/**
+ * Names a trace event.
+ */
+void trace_register(int event, const char *name)
+{
+	if ((event < 0) || (event >= TRACE_EVENTS_NUM))
+		return;
+
+	names[event] = name;
+}
+
+/**
+ * Records a trace event in the buffer of the underlying core.
+ */
+void trace_record(int event, int phase)
+{
+	uint64_t timestamp;
+	struct trace_buffer *b;
+
+	timestamp = k1b_perf_timestamp();
+
+	b = &buffers[k1b_perf_core_id()];
+
+	if (b->n >= TRACE_BUFFER_SIZE)
+	{
+		b->dropped++;
+		return;
+	}
+
+	b->records[b->n++] =
+		(((uint64_t) phase) << 62) |
+		(((uint64_t) (event & 0x3f)) << 56) |
+		(timestamp & TRACE_TIMESTAMP_MASK);
+}
+
+/**
+ * Discards trace events of all cores.
+ */
+void trace_clear(void)
+{
+	for (int core = 0; core < NUM_CORES; core++)
+	{
+		buffers[core].n = 0;
+		buffers[core].dropped = 0;
+	}
+
+	/* Other cores record next. */
+	dcache_invalidate();
+}
+
+/**
+ * Dumps and discards trace events of all cores.
+ */
+void trace_dump(const char *prefix, int it, int nthreads)
+{
+	/* Buffers were written by other cores. */
+	dcache_invalidate();
+
+	for (int core = 0; core < NUM_CORES; core++)
+	{
+		struct trace_buffer *b = &buffers[core];
+
+		for (int i = 0; i < b->n; i++)
+		{
+			uint64_t r = b->records[i];
+			const char *name = names[TRACE_EVENT(r)];
+
+			printf("%s[trace] %d %d %d %llu %c %s\n",
+				prefix,
+				it,
+				nthreads,
+				core,
+				UINT64(TRACE_TIMESTAMP(r)),
+				phases[TRACE_PHASE(r)],
+				(name != NULL) ? name : "-"
+			);
+		}
+
+		if (b->dropped > 0)
+		{
+			printf("%s[trace][dropped] %d %d %d %d\n",
+				prefix,
+				it,
+				nthreads,
+				core,
+				b->dropped
+			);
+		}
+	}
+
+	trace_clear();
+}
@@ -0,0 +1,677 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Each endpoint (the master or a worker cluster) owns a set of inbox
+ * slots. Other endpoints write into them at any offset, and every
+ * write posts one notification to the slot.
+ *
+ * On the MPPA-256, the master runs in the IO cluster, workers are
+ * spawned in compute clusters, slots are NoC portals and barriers are
+ * sync connectors. On Linux hosts, workers are forked processes, and
+ * slots and notifications live in shared memory.
+ */
+
+#ifndef __k1__
+	#define _GNU_SOURCE
+	#include <errno.h>
+	#include <semaphore.h>
+	#include <string.h>
+	#include <sys/mman.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+#else
+	#include <mppaipc.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Endpoint of the caller.
+ */
+static int self = TRANSPORT_MASTER;
+
+/**
+ * @brief Number of workers spawned.
+ */
+static int nworkers = 0;
+
+/**
+ * Parses the arguments of a worker and runs it.
+ */
+int transport_worker(int argc, char **argv, int (*worker)(int, int))
+{
+	if (argc < 3)
+		return (-1);
+
+	self = atoi(argv[1]);
+	nworkers = atoi(argv[2]);
+
+	return (worker(self, nworkers));
+}
+
+#ifdef __k1__
+
+/*============================================================================*
+ * MPPA-256 Backend                                                           *
+ *============================================================================*/
+
+/**
+ * @name NoC Tags
+ */
+/**@{*/
+#define TAG_BARRIER  1 /**< Arrival of Workers  */
+#define TAG_RELEASE  2 /**< Release of Workers  */
+#define TAG_SLOT    16 /**< First Tag of Slots  */
+/**@}*/
+
+/**
+ * @brief NoC rank of the IO cluster.
+ */
+#define IOCLUSTER_RANK 128
+
+/**
+ * @brief Inbox slot.
+ */
+static struct
+{
+	int fd;              /**< Portal              */
+	void *buf;           /**< Buffer              */
+	mppa_aiocb_t aiocb;  /**< Notification        */
+} slots[TRANSPORT_SLOTS_MAX];
+
+/**
+ * @brief Portals to inbox slots of other endpoints.
+ */
+static int portals[TRANSPORT_CLUSTERS_MAX + 1][TRANSPORT_SLOTS_MAX];
+
+/**
+ * @brief Pending writes.
+ */
+static struct
+{
+	int pending;        /**< Write in Progress? */
+	mppa_aiocb_t aiocb; /**< Write              */
+} requests[TRANSPORT_REQUESTS_MAX];
+
+/**
+ * @brief Next write request.
+ */
+static int next_request = 0;
+
+/**
+ * @name Barrier Connectors
+ */
+/**@{*/
+static int barrier_rx = -1; /**< Arrival (master) or Release (workers) */
+static int barrier_tx = -1; /**< Release (master) or Arrival (workers) */
+/**@}*/
+
+/**
+ * @brief Process IDs of workers.
+ */
+static mppa_pid_t pids[TRANSPORT_CLUSTERS_MAX];
+
+/**
+ * @brief Returns the NoC rank of an endpoint.
+ */
+static inline int rank(int endpoint)
+{
+	return ((endpoint == TRANSPORT_MASTER) ? IOCLUSTER_RANK : endpoint);
+}
+
+/**
+ * @brief Match value of the barrier connector of the caller.
+ */
+static inline uint64_t barrier_match(void)
+{
+	if (self == TRANSPORT_MASTER)
+		return (~((UINT64_C(1) << nworkers) - 1));
+
+	return (~UINT64_C(1));
+}
+
+/**
+ * @brief Allocates the buffer of an inbox slot. On compute clusters,
+ * buffers are taken from the arena, so that they count against the
+ * SMEM that it budgets, and they are released along with it.
+ */
+static inline void *slot_alloc(size_t size)
+{
+#ifdef __node__
+	return (arena_alloc(size));
+#else
+	return (malloc(CACHE_LINE_ROUNDUP(size)));
+#endif
+}
+
+/**
+ * @brief Releases the buffer of an inbox slot.
+ */
+static inline void slot_free(void *buf)
+{
+#ifdef __node__
+	UNUSED(buf);
+#else
+	free(buf);
+#endif
+}
+
+/**
+ * @brief Opens the barrier connectors of the caller.
+ */
+static void barrier_open(void)
+{
+	char path[64];
+
+	if (barrier_rx >= 0)
+		return;
+
+	if (self == TRANSPORT_MASTER)
+	{
+		snprintf(path, sizeof(path), "/mppa/sync/%d:%d", IOCLUSTER_RANK, TAG_BARRIER);
+		barrier_rx = mppa_open(path, O_RDONLY);
+
+		snprintf(path, sizeof(path), "/mppa/sync/[0..%d]:%d", nworkers - 1, TAG_RELEASE);
+		barrier_tx = mppa_open(path, O_WRONLY);
+	}
+	else
+	{
+		snprintf(path, sizeof(path), "/mppa/sync/%d:%d", self, TAG_RELEASE);
+		barrier_rx = mppa_open(path, O_RDONLY);
+
+		snprintf(path, sizeof(path), "/mppa/sync/%d:%d", IOCLUSTER_RANK, TAG_BARRIER);
+		barrier_tx = mppa_open(path, O_WRONLY);
+	}
+
+	mppa_ioctl(barrier_rx, MPPA_RX_SET_MATCH, barrier_match());
+}
+
+/**
+ * @brief Closes the barrier connectors of the caller.
+ */
+static void barrier_close(void)
+{
+	if (barrier_rx < 0)
+		return;
+
+	mppa_close(barrier_rx);
+	mppa_close(barrier_tx);
+
+	barrier_rx = -1;
+	barrier_tx = -1;
+}
+
+/**
+ * Opens an inbox slot of the caller.
+ */
+void *transport_open(int slot, size_t size)
+{
+	char path[64];
+
+	if ((slot < 0) || (slot >= TRANSPORT_SLOTS_MAX) || (slots[slot].buf != NULL))
+		return (NULL);
+
+	if ((slots[slot].buf = slot_alloc(size)) == NULL)
+		return (NULL);
+
+	snprintf(path, sizeof(path), "/mppa/portal/%d:%d", rank(self), TAG_SLOT + slot);
+
+	if ((slots[slot].fd = mppa_open(path, O_RDONLY)) < 0)
+	{
+		slot_free(slots[slot].buf);
+		slots[slot].buf = NULL;
+		return (NULL);
+	}
+
+	mppa_aiocb_ctor(&slots[slot].aiocb, slots[slot].fd, slots[slot].buf, size);
+	mppa_aiocb_set_trigger(&slots[slot].aiocb, 1);
+	mppa_aio_read(&slots[slot].aiocb);
+
+	return (slots[slot].buf);
+}
+
+/**
+ * Closes all inbox slots of the caller.
+ */
+void transport_close(void)
+{
+	transport_flush();
+
+	for (int i = 0; i < TRANSPORT_SLOTS_MAX; i++)
+	{
+		if (slots[i].buf == NULL)
+			continue;
+
+		mppa_close(slots[i].fd);
+		slot_free(slots[i].buf);
+		slots[i].buf = NULL;
+	}
+
+	for (int i = 0; i <= TRANSPORT_CLUSTERS_MAX; i++)
+	{
+		for (int j = 0; j < TRANSPORT_SLOTS_MAX; j++)
+		{
+			if (portals[i][j] > 0)
+				mppa_close(portals[i][j]);
+			portals[i][j] = 0;
+		}
+	}
+
+	barrier_close();
+}
+
+/**
+ * Writes into an inbox slot of another endpoint.
+ */
+int transport_send(int endpoint, int slot, const void *buf, size_t size, size_t offset)
+{
+	int req;
+	int *portal;
+
+	if ((endpoint < 0) || (endpoint > TRANSPORT_MASTER) || (slot < 0) || (slot >= TRANSPORT_SLOTS_MAX))
+		return (-1);
+
+	/* Portals are opened on first use. */
+	portal = &portals[endpoint][slot];
+	if (*portal <= 0)
+	{
+		char path[64];
+
+		snprintf(path, sizeof(path), "/mppa/portal/%d:%d", rank(endpoint), TAG_SLOT + slot);
+
+		if ((*portal = mppa_open(path, O_WRONLY)) < 0)
+			return (-1);
+	}
+
+	/* Recycle the oldest request. */
+	req = next_request;
+	next_request = (next_request + 1)%TRANSPORT_REQUESTS_MAX;
+	transport_send_wait(req);
+
+	mppa_aiocb_ctor(&requests[req].aiocb, *portal, (void *) buf, size);
+	mppa_aiocb_set_pwrite(&requests[req].aiocb, (void *) buf, size, offset);
+
+	if (mppa_aio_write(&requests[req].aiocb) < 0)
+		return (-1);
+
+	requests[req].pending = 1;
+
+	return (req);
+}
+
+/**
+ * Waits for a write to complete.
+ */
+void transport_send_wait(int req)
+{
+	if ((req < 0) || (req >= TRANSPORT_REQUESTS_MAX) || (!requests[req].pending))
+		return;
+
+	mppa_aio_wait(&requests[req].aiocb);
+	requests[req].pending = 0;
+}
+
+/**
+ * Waits for all writes of the caller to complete.
+ */
+void transport_flush(void)
+{
+	for (int i = 0; i < TRANSPORT_REQUESTS_MAX; i++)
+		transport_send_wait(i);
+}
+
+/**
+ * Waits for a write into an inbox slot of the caller.
+ */
+void transport_wait(int slot)
+{
+	if ((slot < 0) || (slot >= TRANSPORT_SLOTS_MAX) || (slots[slot].buf == NULL))
+		return;
+
+	mppa_aio_wait(&slots[slot].aiocb);
+
+	/* Rearm before the sender may write again. */
+	mppa_aio_read(&slots[slot].aiocb);
+}
+
+/**
+ * Waits for the master and all workers.
+ */
+void transport_barrier(void)
+{
+	uint64_t value;
+
+	barrier_open();
+
+	if (self == TRANSPORT_MASTER)
+	{
+		value = 1;
+
+		mppa_read(barrier_rx, &value, sizeof(uint64_t));
+		mppa_ioctl(barrier_rx, MPPA_RX_SET_MATCH, barrier_match());
+		mppa_write(barrier_tx, &value, sizeof(uint64_t));
+	}
+	else
+	{
+		value = UINT64_C(1) << self;
+
+		mppa_write(barrier_tx, &value, sizeof(uint64_t));
+		mppa_read(barrier_rx, &value, sizeof(uint64_t));
+		mppa_ioctl(barrier_rx, MPPA_RX_SET_MATCH, barrier_match());
+	}
+}
+
+/**
+ * Spawns workers in compute clusters.
+ */
+int transport_spawn(int nclusters, const char *binary, int (*worker)(int, int))
+{
+	char arg1[8];
+	char arg2[8];
+	const char *argv[] = { binary, arg1, arg2, NULL };
+
+	UNUSED(worker);
+
+	if ((nclusters < 1) || (nclusters > TRANSPORT_CLUSTERS_MAX))
+		return (-1);
+
+	nworkers = nclusters;
+
+	/* Workers arrive before they are released. */
+	barrier_open();
+
+	snprintf(arg2, sizeof(arg2), "%d", nclusters);
+
+	for (int i = 0; i < nclusters; i++)
+	{
+		snprintf(arg1, sizeof(arg1), "%d", i);
+
+		if ((pids[i] = mppa_spawn(i, NULL, binary, argv, NULL)) < 0)
+			return (-1);
+	}
+
+	return (0);
+}
+
+/**
+ * Waits for workers to exit.
+ */
+int transport_join(void)
+{
+	int ret = 0;
+
+	for (int i = 0; i < nworkers; i++)
+	{
+		int status;
+
+		if ((mppa_waitpid(pids[i], &status, 0) < 0) || (status != 0))
+			ret = -1;
+	}
+
+	nworkers = 0;
+
+	return (ret);
+}
+
+#else
+
+/*============================================================================*
+ * Linux Host Backend                                                         *
+ *============================================================================*/
+
+/**
+ * @brief Size of the shared memory window of an endpoint (in bytes).
+ */
+#define TRANSPORT_WINDOW_SIZE (32*1024*1024)
+
+/**
+ * @brief Control block of an endpoint.
+ */
+struct endpoint
+{
+	size_t brk; /**< Next Free Byte of the Window */
+
+	/**
+	 * @brief Inbox slots.
+	 */
+	struct
+	{
+		size_t base; /**< Offset in the Window    */
+		size_t size; /**< Size (0 if closed)      */
+		sem_t full;  /**< Notifications           */
+	} slots[TRANSPORT_SLOTS_MAX];
+};
+
+/**
+ * @brief Shared memory of all endpoints.
+ */
+static struct
+{
+	pthread_barrier_t barrier;                             /**< Barrier */
+	struct endpoint endpoints[TRANSPORT_CLUSTERS_MAX + 1]; /**< Endpoints */
+} *shm = NULL;
+
+/**
+ * @brief Process IDs of workers.
+ */
+static pid_t pids[TRANSPORT_CLUSTERS_MAX];
+
+/**
+ * @brief Returns the shared memory window of an endpoint.
+ */
+static inline char *window(int endpoint)
+{
+	return (((char *) shm) + CACHE_LINE_ROUNDUP(sizeof(*shm)) + ((size_t) endpoint)*TRANSPORT_WINDOW_SIZE);
+}
+
+/**
+ * @brief Maps shared memory. It is inherited by workers.
+ */
+static int shm_map(void)
+{
+	size_t size;
+	void *p;
+
+	if (shm != NULL)
+		return (0);
+
+	size = CACHE_LINE_ROUNDUP(sizeof(*shm)) + ((size_t) TRANSPORT_CLUSTERS_MAX + 1)*TRANSPORT_WINDOW_SIZE;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		return (-1);
+
+	shm = p;
+
+	return (0);
+}
+
+/**
+ * Opens an inbox slot of the caller.
+ */
+void *transport_open(int slot, size_t size)
+{
+	struct endpoint *e;
+
+	if ((slot < 0) || (slot >= TRANSPORT_SLOTS_MAX) || (shm_map() < 0))
+		return (NULL);
+
+	e = &shm->endpoints[self];
+
+	if ((e->slots[slot].size != 0) || (e->brk + size > TRANSPORT_WINDOW_SIZE))
+		return (NULL);
+
+	e->slots[slot].base = e->brk;
+	e->slots[slot].size = size;
+	sem_init(&e->slots[slot].full, 1, 0);
+	e->brk += CACHE_LINE_ROUNDUP(size);
+
+	return (window(self) + e->slots[slot].base);
+}
+
+/**
+ * Closes all inbox slots of the caller.
+ */
+void transport_close(void)
+{
+	struct endpoint *e;
+
+	if (shm == NULL)
+		return;
+
+	e = &shm->endpoints[self];
+
+	for (int i = 0; i < TRANSPORT_SLOTS_MAX; i++)
+	{
+		if (e->slots[i].size == 0)
+			continue;
+
+		sem_destroy(&e->slots[i].full);
+		e->slots[i].size = 0;
+	}
+
+	e->brk = 0;
+}
+
+/**
+ * Writes into an inbox slot of another endpoint.
+ */
+int transport_send(int endpoint, int slot, const void *buf, size_t size, size_t offset)
+{
+	struct endpoint *e;
+
+	if ((shm == NULL) || (endpoint < 0) || (endpoint > TRANSPORT_MASTER) || (slot < 0) || (slot >= TRANSPORT_SLOTS_MAX))
+		return (-1);
+
+	e = &shm->endpoints[endpoint];
+
+	if (offset + size > e->slots[slot].size)
+		return (-1);
+
+	/* Copies are synchronous. */
+	memcpy(window(endpoint) + e->slots[slot].base + offset, buf, size);
+	sem_post(&e->slots[slot].full);
+
+	return (0);
+}
+
+/**
+ * Waits for a write to complete.
+ */
+void transport_send_wait(int req)
+{
+	UNUSED(req);
+}
+
+/**
+ * Waits for all writes of the caller to complete.
+ */
+void transport_flush(void)
+{
+}
+
+/**
+ * Waits for a write into an inbox slot of the caller.
+ */
+void transport_wait(int slot)
+{
+	if ((shm == NULL) || (slot < 0) || (slot >= TRANSPORT_SLOTS_MAX))
+		return;
+
+	while ((sem_wait(&shm->endpoints[self].slots[slot].full) < 0) && (errno == EINTR))
+		/* noop */ ;
+}
+
+/**
+ * Waits for the master and all workers.
+ */
+void transport_barrier(void)
+{
+	if (shm != NULL)
+		pthread_barrier_wait(&shm->barrier);
+}
+
+/**
+ * Spawns workers in child processes.
+ */
+int transport_spawn(int nclusters, const char *binary, int (*worker)(int, int))
+{
+	pthread_barrierattr_t attr;
+
+	UNUSED(binary);
+
+	if ((nclusters < 1) || (nclusters > TRANSPORT_CLUSTERS_MAX) || (shm_map() < 0))
+		return (-1);
+
+	nworkers = nclusters;
+
+	pthread_barrierattr_init(&attr);
+	pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&shm->barrier, &attr, nclusters + 1);
+	pthread_barrierattr_destroy(&attr);
+
+	/* Children would flush it again. */
+	fflush(stdout);
+
+	for (int i = 0; i < nclusters; i++)
+	{
+		if ((pids[i] = fork()) < 0)
+			return (-1);
+
+		if (pids[i] == 0)
+		{
+			int status;
+
+			self = i;
+			status = worker(i, nclusters);
+			fflush(stdout);
+
+			_exit(status);
+		}
+	}
+
+	return (0);
+}
+
+/**
+ * Waits for workers to exit.
+ */
+int transport_join(void)
+{
+	int ret = 0;
+
+	for (int i = 0; i < nworkers; i++)
+	{
+		int status;
+
+		if ((waitpid(pids[i], &status, 0) < 0) || (!WIFEXITED(status)) || (WEXITSTATUS(status) != 0))
+			ret = -1;
+	}
+
+	if (nworkers > 0)
+		pthread_barrier_destroy(&shm->barrier);
+
+	nworkers = 0;
+
+	return (ret);
+}
+
+#endif
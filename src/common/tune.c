@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The search first evaluates a coarse grid, with TUNE_LEVELS values of
+ * each parameter, and then climbs from the best point one step at a
+ * time, until no neighbour is faster or the time budget runs out.
+ *
+ * Best configurations are printed as [tuning] lines, which
+ * tools/tuning turns into include/tuning.h. Since compute clusters
+ * have no file system, the tuning file is compiled into binaries.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cap-bench.h>
+
+/**
+ * @brief Number of values of each parameter in the grid.
+ */
+#define TUNE_LEVELS 3
+
+/**
+ * @brief Name of the target.
+ */
+#if defined(__node__)
+	#define TUNE_TARGET "ccluster"
+#elif defined(__k1__)
+	#define TUNE_TARGET "iocluster"
+#else
+	#define TUNE_TARGET "host"
+#endif
+
+/**
+ * @brief Tuned parameter.
+ */
+struct tuning
+{
+	const char *kernel; /**< Kernel                    */
+	const char *target; /**< Target                    */
+	int size;           /**< Problem Size              */
+	int nthreads;       /**< Number of Working Threads */
+	const char *name;   /**< Parameter                 */
+	int value;          /**< Best Value                */
+};
+
+/**
+ * @brief Tuned parameters.
+ */
+static const struct tuning tunings[] = {
+	#define TUNING(kernel, target, size, nthreads, name, value) { kernel, target, size, nthreads, name, value },
+	#include <tuning.h>
+	#undef TUNING
+	{ NULL, NULL, 0, 0, NULL, 0 }
+};
+
+/**
+ * @brief State of a search.
+ */
+static struct
+{
+	int nparams;                  /**< Number of Parameters     */
+	uint64_t start;               /**< Start Time               */
+	uint64_t best;                /**< Fastest Evaluation       */
+	int values[TUNE_PARAMS_MAX];  /**< Fastest Configuration    */
+} search;
+
+/**
+ * Returns the tuned value of a parameter.
+ */
+int tune_get(const char *kernel, int size, int nthreads, const char *name, int value)
+{
+	for (int i = 0; tunings[i].kernel != NULL; i++)
+	{
+		if (strcmp(tunings[i].kernel, kernel) || strcmp(tunings[i].target, TUNE_TARGET))
+			continue;
+
+		if ((tunings[i].size == size) && (tunings[i].nthreads == nthreads) && (!strcmp(tunings[i].name, name)))
+			return (tunings[i].value);
+	}
+
+	return (value);
+}
+
+/**
+ * @brief Asserts whether the time budget of the search is over.
+ */
+static inline int tune_expired(void)
+{
+	return (CYCLES_TO_SECONDS(k1b_perf_timestamp() - search.start) > TUNE_BUDGET);
+}
+
+/**
+ * @brief Evaluates the current configuration and keeps it if it is
+ * the fastest one.
+ *
+ * @returns One if the configuration is the fastest one, and zero
+ * otherwise.
+ */
+static int tune_try(const char *prefix, int size, int nthreads, struct tune_param *params, uint64_t (*evaluate)(int, const struct tune_param *, int))
+{
+	uint64_t cycles;
+
+	cycles = evaluate(nthreads, params, search.nparams);
+
+#ifdef NDEBUG
+	printf("%s[tune] %d %d %llu", prefix, size, nthreads, UINT64(cycles));
+	for (int i = 0; i < search.nparams; i++)
+		printf(" %d", params[i].value);
+	printf("\n");
+#else
+	printf("%s[tune] size=%d    nthreads=%d    time=%.6f s   ", prefix, size, nthreads, CYCLES_TO_SECONDS(cycles));
+	for (int i = 0; i < search.nparams; i++)
+		printf(" %s=%d", params[i].name, params[i].value);
+	printf("\n");
+#endif
+
+	if (cycles >= search.best)
+		return (0);
+
+	search.best = cycles;
+	for (int i = 0; i < search.nparams; i++)
+		search.values[i] = params[i].value;
+
+	return (1);
+}
+
+/**
+ * @brief Returns a level of a parameter in the grid.
+ */
+static inline int tune_level(const struct tune_param *p, int level)
+{
+	int nsteps = (p->max - p->min)/p->step;
+
+	return (p->min + ((nsteps*level)/(TUNE_LEVELS - 1))*p->step);
+}
+
+/**
+ * Searches the fastest configuration of a kernel.
+ */
+void tune_search(const char *prefix, int size, int nthreads, struct tune_param *params, int nparams, uint64_t (*evaluate)(int, const struct tune_param *, int))
+{
+	int levels[TUNE_PARAMS_MAX];
+	int improved;
+
+	if ((nparams < 1) || (nparams > TUNE_PARAMS_MAX))
+		return;
+
+	search.nparams = nparams;
+	search.start = k1b_perf_timestamp();
+	search.best = UINT64_MAX;
+
+	/* Coarse grid. */
+	for (int i = 0; i < nparams; i++)
+		levels[i] = 0;
+
+	do
+	{
+		int i;
+
+		for (i = 0; i < nparams; i++)
+			params[i].value = tune_level(&params[i], levels[i]);
+
+		tune_try(prefix, size, nthreads, params, evaluate);
+
+		/* Next point of the grid. */
+		for (i = 0; i < nparams; i++)
+		{
+			if (++levels[i] < TUNE_LEVELS)
+				break;
+			levels[i] = 0;
+		}
+
+		if (i == nparams)
+			break;
+	} while (!tune_expired());
+
+	/* Hill climbing. */
+	do
+	{
+		improved = 0;
+
+		for (int i = 0; (i < nparams) && (!tune_expired()); i++)
+		{
+			for (int dir = -1; dir <= 1; dir += 2)
+			{
+				int value = search.values[i] + dir*params[i].step;
+
+				if ((value < params[i].min) || (value > params[i].max))
+					continue;
+
+				for (int j = 0; j < nparams; j++)
+					params[j].value = search.values[j];
+				params[i].value = value;
+
+				improved |= tune_try(prefix, size, nthreads, params, evaluate);
+			}
+		}
+	} while ((improved) && (!tune_expired()));
+
+	for (int i = 0; i < nparams; i++)
+		params[i].value = search.values[i];
+
+	/* Record for tools/tuning. */
+	printf("%s[tuning] %s %d %d %llu", prefix, TUNE_TARGET, size, nthreads, UINT64(search.best));
+	for (int i = 0; i < nparams; i++)
+		printf(" %s=%d", params[i].name, params[i].value);
+	printf("\n");
+}
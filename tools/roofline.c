@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Builds a roofline dataset from the output of release builds. The
+ * compute ceiling is the best throughput of additions, multiplications
+ * and fused multiply-adds measured by the FPU micro-kernels, and the
+ * memory ceiling is the triad bandwidth measured by STREAM on its
+ * largest arrays. Both are taken for the same number of threads as
+ * each kernel point.
+ *
+ * Usage: roofline [-f frequency] < logs > roofline.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Default cluster frequency (in MHz).
+ */
+#define FREQUENCY_DEFAULT 400
+
+/**
+ * @brief Maximum length of a line.
+ */
+#define LINE_LENGTH 1024
+
+/**
+ * @brief Maximum length of a name.
+ */
+#define NAME_LENGTH 32
+
+/**
+ * @brief Maximum number of working threads.
+ */
+#define NTHREADS_MAX 64
+
+/**
+ * @brief Maximum number of kernel points.
+ */
+#define NPOINTS_MAX 1024
+
+/**
+ * @brief Roofline point of a kernel. Compute-only kernels have no
+ * intensity, which is kept as zero.
+ */
+struct point
+{
+	char kernel[NAME_LENGTH]; /**< Kernel                              */
+	int nthreads;             /**< Number of Working Threads           */
+	double intensity;         /**< Operational Intensity (flops/B)     */
+	double gflops;            /**< Attained Performance (GFLOPS)       */
+};
+
+/**
+ * @brief Kernel points.
+ */
+static struct point points[NPOINTS_MAX];
+
+/**
+ * @brief Number of kernel points.
+ */
+static int npoints = 0;
+
+/**
+ * @brief Best floating point throughput of each thread (flops per cycle).
+ */
+static double peak[NTHREADS_MAX + 1][NTHREADS_MAX];
+
+/**
+ * @name Triad Bandwidth
+ */
+/**@{*/
+static unsigned long long triad_size[NTHREADS_MAX + 1]; /**< Largest Array Size */
+static double triad[NTHREADS_MAX + 1];                  /**< Bandwidth (GB/s)   */
+/**@}*/
+
+/**
+ * @brief Parses a FPU micro-kernel line.
+ */
+static void parse_fpu(const char *p)
+{
+	int it, nthreads, tnum, nops;
+	char op[NAME_LENGTH], precision[NAME_LENGTH], mode[NAME_LENGTH];
+	unsigned long long cycles, corrected;
+	double cpo, opc;
+	int flops;
+
+	if (sscanf(p, "%d %d %d %31s %31s %31s %d %llu %llu %lf %lf",
+		&it, &nthreads, &tnum, op, precision, mode, &nops, &cycles, &corrected, &cpo, &opc) != 11)
+		return;
+
+	if ((nthreads < 1) || (nthreads > NTHREADS_MAX) || (tnum < 0) || (tnum >= NTHREADS_MAX))
+		return;
+
+	if (strcmp(mode, "throughput"))
+		return;
+
+	/* Each FMA counts as two operations. */
+	if (!strcmp(op, "fma"))
+		flops = 2;
+	else if ((!strcmp(op, "add")) || (!strcmp(op, "mul")))
+		flops = 1;
+	else
+		return;
+
+	if (flops*opc > peak[nthreads][tnum])
+		peak[nthreads][tnum] = flops*opc;
+}
+
+/**
+ * @brief Parses a STREAM line.
+ */
+static void parse_stream(const char *p)
+{
+	int it, nthreads;
+	char memory[NAME_LENGTH], op[NAME_LENGTH];
+	unsigned long long size, bytes, cycles;
+	double bandwidth;
+
+	if (sscanf(p, "%d %d %31s %31s %llu %llu %llu %lf",
+		&it, &nthreads, memory, op, &size, &bytes, &cycles, &bandwidth) != 8)
+		return;
+
+	if ((nthreads < 1) || (nthreads > NTHREADS_MAX) || strcmp(op, "triad"))
+		return;
+
+	if (size > triad_size[nthreads])
+	{
+		triad_size[nthreads] = size;
+		triad[nthreads] = 0.0;
+	}
+
+	if ((size == triad_size[nthreads]) && (bandwidth > triad[nthreads]))
+		triad[nthreads] = bandwidth;
+}
+
+/**
+ * @brief Parses a roofline point.
+ */
+static void parse_point(const char *line, const char *p)
+{
+	const char *begin;
+	const char *end;
+	struct point *pt;
+	double flops, bytes;
+	unsigned long long cycles;
+	char intensity[NAME_LENGTH];
+
+	if (npoints == NPOINTS_MAX)
+		return;
+
+	pt = &points[npoints];
+
+	if (sscanf(p, "%d %lf %lf %llu %31s %lf",
+		&pt->nthreads, &flops, &bytes, &cycles, intensity, &pt->gflops) != 6)
+		return;
+
+	pt->intensity = (!strcmp(intensity, "n/a")) ? 0.0 : atof(intensity);
+
+	/* Kernel name is the last tag of the prefix. */
+	if ((end = strstr(line, "][roofline]")) == NULL)
+		return;
+	for (begin = end; (begin > line) && (begin[-1] != '['); begin--)
+		/* noop */ ;
+
+	if ((end - begin) >= NAME_LENGTH)
+		return;
+
+	memcpy(pt->kernel, begin, end - begin);
+	pt->kernel[end - begin] = '\0';
+
+	npoints++;
+}
+
+/**
+ * @brief Parses logs.
+ */
+static void parse(void)
+{
+	char line[LINE_LENGTH];
+
+	while (fgets(line, sizeof(line), stdin) != NULL)
+	{
+		char *p;
+
+		if ((p = strstr(line, "[roofline] ")) != NULL)
+			parse_point(line, p + strlen("[roofline] "));
+		else if ((p = strstr(line, "[benchmarks][fpu-ukernel] ")) != NULL)
+			parse_fpu(p + strlen("[benchmarks][fpu-ukernel] "));
+		else if ((p = strstr(line, "[benchmarks][stream] ")) != NULL)
+			parse_stream(p + strlen("[benchmarks][stream] "));
+	}
+}
+
+/**
+ * @brief Dumps the roofline dataset.
+ *
+ * @param frequency Cluster frequency (in MHz).
+ */
+static void dump(int frequency)
+{
+	printf("kernel,nthreads,intensity,gflops,peak_gflops,bandwidth_gbs,ceiling_gflops,attained,bound\n");
+
+	for (int i = 0; i < npoints; i++)
+	{
+		const struct point *pt = &points[i];
+		double compute = 0.0;
+		double bandwidth = triad[pt->nthreads];
+		double ceiling;
+		const char *bound;
+
+		for (int t = 0; t < pt->nthreads; t++)
+			compute += peak[pt->nthreads][t]*frequency/1000;
+
+		if (pt->intensity > 0.0)
+			printf("%s,%d,%.4f,%.4f,", pt->kernel, pt->nthreads, pt->intensity, pt->gflops);
+		else
+			printf("%s,%d,n/a,%.4f,", pt->kernel, pt->nthreads, pt->gflops);
+
+		if ((compute <= 0.0) || ((pt->intensity > 0.0) && (bandwidth <= 0.0)))
+		{
+			printf("-,-,-,-,-\n");
+			continue;
+		}
+
+		/* Kernels with no memory traffic are bound by compute. */
+		if ((pt->intensity <= 0.0) || (compute < bandwidth*pt->intensity))
+		{
+			ceiling = compute;
+			bound = "compute";
+		}
+		else
+		{
+			ceiling = bandwidth*pt->intensity;
+			bound = "memory";
+		}
+
+		printf("%.4f,%.4f,%.4f,%.4f,%s\n", compute, bandwidth, ceiling, pt->gflops/ceiling, bound);
+	}
+}
+
+/**
+ * @brief Builds a roofline dataset.
+ */
+int main(int argc, char **argv)
+{
+	int frequency = FREQUENCY_DEFAULT;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((!strcmp(argv[i], "-f")) && (i + 1 < argc))
+			frequency = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: roofline [-f frequency] < logs > roofline.csv\n");
+			return (EXIT_FAILURE);
+		}
+	}
+
+	if (frequency <= 0)
+		frequency = FREQUENCY_DEFAULT;
+
+	parse();
+	dump(frequency);
+
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Converts trace events dumped by kernels into the Chrome trace event
+ * format, which may be opened in chrome://tracing or Perfetto. Each
+ * number of working threads is a process, and each core a thread.
+ *
+ * Usage: trace2chrome [-f frequency] [-i iteration] < log > trace.json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Default cluster frequency (in MHz).
+ */
+#define FREQUENCY_DEFAULT 400
+
+/**
+ * @brief Maximum length of a line.
+ */
+#define LINE_LENGTH 256
+
+/**
+ * @brief Maximum length of a name.
+ */
+#define NAME_LENGTH 32
+
+/**
+ * @brief Maximum number of working threads.
+ */
+#define NTHREADS_MAX 64
+
+/**
+ * @brief Trace record.
+ */
+struct record
+{
+	int nthreads;                 /**< Number of Working Threads */
+	int core;                     /**< Core                      */
+	unsigned long long timestamp; /**< Timestamp (in cycles)     */
+	char phase;                   /**< Phase                     */
+	char name[NAME_LENGTH];       /**< Name of the Event         */
+};
+
+/**
+ * @brief Records read from the log.
+ */
+static struct record *records = NULL;
+
+/**
+ * @brief Number of records.
+ */
+static int nrecords = 0;
+
+/**
+ * @brief Capacity of records array.
+ */
+static int capacity = 0;
+
+/**
+ * @brief Earliest timestamp of each number of threads.
+ */
+static unsigned long long origin[NTHREADS_MAX + 1];
+
+/**
+ * @brief Appends a record.
+ */
+static void record_add(const struct record *r)
+{
+	if (nrecords == capacity)
+	{
+		capacity = (capacity == 0) ? 1024 : 2*capacity;
+		records = realloc(records, capacity*sizeof(struct record));
+
+		if (records == NULL)
+		{
+			fprintf(stderr, "trace2chrome: out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	records[nrecords++] = *r;
+}
+
+/**
+ * @brief Parses the log.
+ *
+ * @param iteration Benchmark iteration to convert.
+ */
+static void parse(int iteration)
+{
+	char line[LINE_LENGTH];
+
+	while (fgets(line, sizeof(line), stdin) != NULL)
+	{
+		int it;
+		char *p;
+		struct record r;
+
+		/* Dropped events. */
+		if ((p = strstr(line, "[trace][dropped] ")) != NULL)
+		{
+			int dropped;
+
+			if (sscanf(p + strlen("[trace][dropped] "), "%d %d %d %d", &it, &r.nthreads, &r.core, &dropped) == 4)
+			{
+				if (it == iteration)
+					fprintf(stderr, "trace2chrome: nthreads=%d core=%d dropped %d events\n", r.nthreads, r.core, dropped);
+			}
+
+			continue;
+		}
+
+		if ((p = strstr(line, "[trace] ")) == NULL)
+			continue;
+
+		if (sscanf(p + strlen("[trace] "), "%d %d %d %llu %c %31s",
+			&it, &r.nthreads, &r.core, &r.timestamp, &r.phase, r.name) != 6)
+			continue;
+
+		if ((it != iteration) || (r.nthreads < 0) || (r.nthreads > NTHREADS_MAX))
+			continue;
+
+		if ((origin[r.nthreads] == 0) || (r.timestamp < origin[r.nthreads]))
+			origin[r.nthreads] = r.timestamp;
+
+		record_add(&r);
+	}
+}
+
+/**
+ * @brief Dumps records in the Chrome trace event format.
+ *
+ * @param frequency Cluster frequency (in MHz).
+ */
+static void dump(int frequency)
+{
+	int first = 1;
+
+	printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	/* Name processes. */
+	for (int n = 0; n <= NTHREADS_MAX; n++)
+	{
+		if (origin[n] == 0)
+			continue;
+
+		printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"nthreads=%d\"}}",
+			first ? "" : ",\n", n, n);
+		first = 0;
+	}
+
+	for (int i = 0; i < nrecords; i++)
+	{
+		const struct record *r = &records[i];
+
+		printf("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d%s}",
+			first ? "" : ",\n",
+			r->name,
+			r->phase,
+			((double) (r->timestamp - origin[r->nthreads]))/frequency,
+			r->nthreads,
+			r->core,
+			(r->phase == 'i') ? ",\"s\":\"t\"" : ""
+		);
+		first = 0;
+	}
+
+	printf("\n]}\n");
+}
+
+/**
+ * @brief Converts trace events into the Chrome trace event format.
+ */
+int main(int argc, char **argv)
+{
+	int frequency = FREQUENCY_DEFAULT;
+	int iteration = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((!strcmp(argv[i], "-f")) && (i + 1 < argc))
+			frequency = atoi(argv[++i]);
+		else if ((!strcmp(argv[i], "-i")) && (i + 1 < argc))
+			iteration = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: trace2chrome [-f frequency] [-i iteration] < log > trace.json\n");
+			return (EXIT_FAILURE);
+		}
+	}
+
+	if (frequency <= 0)
+		frequency = FREQUENCY_DEFAULT;
+
+	parse(iteration);
+	dump(frequency);
+
+	free(records);
+
+	return (EXIT_SUCCESS);
+}
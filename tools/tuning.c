@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2013-2019 The Engineers of CAP Bench
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Builds the tuning file from the output of TUNE builds. When logs
+ * hold several searches of a kernel for the same target, size and
+ * number of threads, the fastest configuration is kept.
+ *
+ * Usage: tuning < logs > include/tuning.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Maximum length of a line.
+ */
+#define LINE_LENGTH 1024
+
+/**
+ * @brief Maximum length of a name.
+ */
+#define NAME_LENGTH 32
+
+/**
+ * @brief Maximum number of parameters of a configuration.
+ */
+#define NPARAMS_MAX 8
+
+/**
+ * @brief Maximum number of configurations.
+ */
+#define NCONFIGS_MAX 256
+
+/**
+ * @brief Best configuration of a kernel.
+ */
+struct config
+{
+	char kernel[NAME_LENGTH];             /**< Kernel               */
+	char target[NAME_LENGTH];             /**< Target               */
+	int size;                             /**< Problem Size         */
+	int nthreads;                         /**< Working Threads      */
+	unsigned long long cycles;            /**< Execution Time       */
+	int nparams;                          /**< Number of Parameters */
+	char names[NPARAMS_MAX][NAME_LENGTH]; /**< Parameters           */
+	int values[NPARAMS_MAX];              /**< Values               */
+};
+
+/**
+ * @brief Configurations.
+ */
+static struct config configs[NCONFIGS_MAX];
+
+/**
+ * @brief Number of configurations.
+ */
+static int nconfigs = 0;
+
+/**
+ * @brief Parses a tuning record.
+ */
+static void parse_record(const char *line, const char *p)
+{
+	const char *begin;
+	const char *end;
+	struct config c;
+	int n;
+
+	memset(&c, 0, sizeof(struct config));
+
+	if (sscanf(p, "%31s %d %d %llu%n", c.target, &c.size, &c.nthreads, &c.cycles, &n) != 4)
+		return;
+	p += n;
+
+	while ((c.nparams < NPARAMS_MAX) && (sscanf(p, " %31[^=]=%d%n", c.names[c.nparams], &c.values[c.nparams], &n) == 2))
+	{
+		c.nparams++;
+		p += n;
+	}
+
+	/* Kernel name is the last tag of the prefix. */
+	if ((end = strstr(line, "][tuning]")) == NULL)
+		return;
+	for (begin = end; (begin > line) && (begin[-1] != '['); begin--)
+		/* noop */ ;
+
+	if ((end - begin) >= NAME_LENGTH)
+		return;
+
+	memcpy(c.kernel, begin, end - begin);
+	c.kernel[end - begin] = '\0';
+
+	for (int i = 0; i < nconfigs; i++)
+	{
+		if (strcmp(configs[i].kernel, c.kernel) || strcmp(configs[i].target, c.target) || (configs[i].size != c.size) || (configs[i].nthreads != c.nthreads))
+			continue;
+
+		if (c.cycles < configs[i].cycles)
+			configs[i] = c;
+
+		return;
+	}
+
+	if (nconfigs < NCONFIGS_MAX)
+		configs[nconfigs++] = c;
+}
+
+/**
+ * @brief Dumps the tuning file.
+ */
+static void dump(void)
+{
+	static const char *header[] = {
+		"/*",
+		" * Copyright (C) 2013-2019 The Engineers of CAP Bench",
+		" *",
+		" * This program is free software: you can redistribute it and/or modify",
+		" * it under the terms of the GNU General Public License as published by",
+		" * the Free Software Foundation, either version 3 of the License, or",
+		" * (at your option) any later version.",
+		" *",
+		" * This program is distributed in the hope that it will be useful,",
+		" * but WITHOUT ANY WARRANTY; without even the implied warranty of",
+		" * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the",
+		" * GNU General Public License for more details.",
+		" *",
+		" * You should have received a copy of the GNU General Public License",
+		" * along with this program.  If not, see <https://www.gnu.org/licenses/>.",
+		" */",
+		"",
+		"/*",
+		" * Tuning file. Each entry is the best value of a kernel parameter for",
+		" * a target, problem size and number of working threads:",
+		" *",
+		" *   TUNING(kernel, target, size, nthreads, name, value)",
+		" *",
+		" * Entries are generated from the output of TUNE builds:",
+		" *",
+		" *   bin/tuning < logs > include/tuning.h",
+		" *",
+		" * No include guard: this file is expanded into a table.",
+		" */",
+		NULL
+	};
+
+	for (int i = 0; header[i] != NULL; i++)
+		printf("%s\n", header[i]);
+	printf("\n");
+
+	for (int i = 0; i < nconfigs; i++)
+	{
+		for (int j = 0; j < configs[i].nparams; j++)
+		{
+			printf("TUNING(\"%s\", \"%s\", %d, %d, \"%s\", %d)\n",
+				configs[i].kernel,
+				configs[i].target,
+				configs[i].size,
+				configs[i].nthreads,
+				configs[i].names[j],
+				configs[i].values[j]
+			);
+		}
+	}
+}
+
+/**
+ * @brief Builds the tuning file.
+ */
+int main(int argc, char **argv)
+{
+	char line[LINE_LENGTH];
+
+	((void) argv);
+
+	if (argc > 1)
+	{
+		fprintf(stderr, "usage: tuning < logs > include/tuning.h\n");
+		return (EXIT_FAILURE);
+	}
+
+	while (fgets(line, sizeof(line), stdin) != NULL)
+	{
+		char *p;
+
+		if ((p = strstr(line, "][tuning] ")) != NULL)
+			parse_record(line, p + strlen("][tuning] "));
+	}
+
+	dump();
+
+	return (EXIT_SUCCESS);
+}